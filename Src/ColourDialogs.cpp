@@ -25,6 +25,7 @@
 #include "Image.h"
 #include "TacentView.h"
 #include "Preferences.h"
+#include "Task.h"
 #include "Version.cmake.h"
 using namespace tMath;
 
@@ -323,16 +324,43 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 	static float levelsOutWhite = 1.0f;
 	static bool allFrames = true;
 	static int channels = int(Image::AdjChan::RGB);
+	static bool previewed = false;
+
+	// While the dialog is open only the displayed frame is adjusted so the sliders stay interactive no matter how many
+	// frames there are. If all frames are selected the adjustment is applied to every frame as a task on OK.
+	auto previewAdjustment = []()
+	{
+		Image::AdjChan adjChan = Image::AdjChan(channels);
+		switch (currTab)
+		{
+			case TabEnum::Levels:
+			{
+				bool powerMidGamma = Config::GetProfileData().LevelsPowerMidGamma;
+				CurrImage->AdjustLevels(levelsBlack, levelsMid, levelsWhite, levelsOutBlack, levelsOutWhite, powerMidGamma, adjChan, false);
+				break;
+			}
+
+			case TabEnum::Contrast:
+				CurrImage->AdjustContrast(contrast, adjChan, false);
+				break;
+
+			case TabEnum::Brightness:
+				CurrImage->AdjustBrightness(brightness, adjChan, false);
+				break;
+		}
+	};
 
 	if (levelsPressed)
 	{
 		ImGui::OpenPopup("Adjust Levels");
 		popupOpen = true;
 
-		// This gets called whenever the levels dialog gets opened.
+		// This gets called whenever the levels dialog gets opened. Playback is stopped so the previewed frame stays up.
+		CurrImage->Stop();
 		CurrImage->AdjustmentBegin();
 		CurrImage->AdjustGetDefaults(brightness, contrast, levelsBlack, levelsMid, levelsWhite, levelsOutBlack, levelsOutWhite);
 		okPressed = false;
+		previewed = false;
 	}
 
 	bool isOpenLevels = true;
@@ -340,14 +368,14 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 	{
 		if (popupOpen)
 		{
-			// This gets called whenever the levels dialog gets closed.
+			// This gets called whenever the levels dialog gets closed. OK already ended the adjustment.
 			if (!okPressed)
 			{
 				CurrImage->Unbind();
 				CurrImage->AdjustRestoreOriginal();
 				CurrImage->Bind();
+				CurrImage->AdjustmentEnd();
 			}
-			CurrImage->AdjustmentEnd();
 		}
 		popupOpen = false;
 		return;
@@ -375,6 +403,7 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 				CurrImage->AdjustRestoreOriginal();
 				CurrImage->Bind();
 				currTab = TabEnum::Levels;
+				previewed = false;
 			}
 			ImGui::NewLine();
 			bool modified = false;
@@ -390,7 +419,7 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 					CurrImage->AdjustRestoreOriginal();
 					modified = true;
 				}
-				ImGui::SameLine(); Gutil::HelpMark("If image is animated or otherwise has more than one frame\nsetting this to false allows only the single current frames to be adjusted.\nMake sure the image is stopped on the frame you want before opening the levels dialog.");
+				ImGui::SameLine(); Gutil::HelpMark("If image is animated or otherwise has more than one frame\nsetting this to false allows only the single current frames to be adjusted.\nMake sure the image is stopped on the frame you want before opening the levels dialog.\nWhile adjusting, only the current frame is previewed. All frames are updated on OK.");
 			}
 
 			//
@@ -498,8 +527,9 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 				tiClampMin(levelsOutWhite, levelsOutBlack);
 
 				CurrImage->Unbind();
-				CurrImage->AdjustLevels(levelsBlack, levelsMid, levelsWhite, levelsOutBlack, levelsOutWhite, profile.LevelsPowerMidGamma, Image::AdjChan(channels), allFrames);
+				previewAdjustment();
 				CurrImage->Bind();
+				previewed = true;
 			}
 
 			ImGui::EndTabItem();
@@ -517,6 +547,7 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 				CurrImage->AdjustRestoreOriginal();
 				CurrImage->Bind();
 				currTab = TabEnum::Contrast;
+				previewed = false;
 			}
 			ImGui::NewLine();
 			bool modified = false;
@@ -532,7 +563,7 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 					CurrImage->AdjustRestoreOriginal();
 					modified = true;
 				}
-				ImGui::SameLine(); Gutil::HelpMark("If image is animated or otherwise has more than one frame\nsetting this to false allows only the single current frames to be adjusted.\nMake sure the image is stopped on the frame you want before opening the levels dialog.");
+				ImGui::SameLine(); Gutil::HelpMark("If image is animated or otherwise has more than one frame\nsetting this to false allows only the single current frames to be adjusted.\nMake sure the image is stopped on the frame you want before opening the levels dialog.\nWhile adjusting, only the current frame is previewed. All frames are updated on OK.");
 			}
 
 			//
@@ -554,8 +585,9 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 			if (modified)
 			{
 				CurrImage->Unbind();
-				CurrImage->AdjustContrast(contrast, Image::AdjChan(channels));
+				previewAdjustment();
 				CurrImage->Bind();
+				previewed = true;
 			}
 
 			ImGui::EndTabItem();
@@ -573,6 +605,7 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 				CurrImage->AdjustRestoreOriginal();
 				CurrImage->Bind();
 				currTab = TabEnum::Brightness;
+				previewed = false;
 			}
 			ImGui::NewLine();
 			bool modified = false;
@@ -588,7 +621,7 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 					CurrImage->AdjustRestoreOriginal();
 					modified = true;
 				}
-				ImGui::SameLine(); Gutil::HelpMark("If image is animated or otherwise has more than one frame\nsetting this to false allows only the single current frames to be adjusted.\nMake sure the image is stopped on the frame you want before opening the levels dialog.");
+				ImGui::SameLine(); Gutil::HelpMark("If image is animated or otherwise has more than one frame\nsetting this to false allows only the single current frames to be adjusted.\nMake sure the image is stopped on the frame you want before opening the levels dialog.\nWhile adjusting, only the current frame is previewed. All frames are updated on OK.");
 			}
 
 			//
@@ -610,8 +643,9 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 			if (modified)
 			{
 				CurrImage->Unbind();
-				CurrImage->AdjustBrightness(brightness, Image::AdjChan(channels));
+				previewAdjustment();
 				CurrImage->Bind();
+				previewed = true;
 			}
 
 			ImGui::EndTabItem();
@@ -634,6 +668,7 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 		CurrImage->Unbind();
 		CurrImage->AdjustRestoreOriginal();
 		CurrImage->Bind();
+		previewed = false;
 	}
 
 	if (Gutil::Button("Cancel", tVector2(buttonWidth, 0.0f)))
@@ -649,6 +684,41 @@ void Viewer::DoLevelsModal(bool levelsPressed)
 		ImGui::SetKeyboardFocusHere();
 	if (Gutil::Button("OK", tVector2(buttonWidth, 0.0f)))
 	{
+		// The preview only touched the current frame. The originals are restored (dropping the undo step pushed when
+		// the dialog opened) and every frame is adjusted as a task with its own undo step. The adjustment is ended
+		// here, not when the popup closes next frame, because the task may replace the pictures before then.
+		if (previewed && allFrames && (CurrImage->GetNumFrames() > 1))
+		{
+			CurrImage->Unbind();
+			CurrImage->AdjustRestoreOriginal(true);
+			CurrImage->Bind();
+			CurrImage->AdjustmentEnd();
+
+			comp_t chanBits = Image::ComponentBits(Image::AdjChan(channels));
+			TabEnum tab = currTab;
+			float black = levelsBlack, mid = levelsMid, white = levelsWhite, outBlack = levelsOutBlack, outWhite = levelsOutWhite;
+			float bright = brightness, contr = contrast;
+			bool powerMidGamma = profile.LevelsPowerMidGamma;
+			Task::StartPictureEdit
+			(
+				CurrImage, "Adjusting Levels", "Levels",
+				[=](tImage::tPicture& picture)
+				{
+					picture.AdjustmentBegin();
+					switch (tab)
+					{
+						case TabEnum::Levels:		picture.AdjustLevels(black, mid, white, outBlack, outWhite, powerMidGamma, chanBits);	break;
+						case TabEnum::Contrast:		picture.AdjustContrast(contr, chanBits);												break;
+						case TabEnum::Brightness:	picture.AdjustBrightness(bright, chanBits);												break;
+					}
+					picture.AdjustmentEnd();
+				}
+			);
+		}
+		else
+		{
+			CurrImage->AdjustmentEnd();
+		}
 		okPressed = true;
 		Gutil::SetWindowTitle();
 		ImGui::CloseCurrentPopup();
@@ -17,6 +17,11 @@
 #ifdef PLATFORM_WINDOWS
 #include <windows.h>
 #endif
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
 #include <Foundation/tFundamentals.h>
 #include <System/tCmdLine.h>
 #include <System/tPrint.h>
@@ -25,6 +30,10 @@
 #include "Command.h"
 #include "CommandHelp.h"
 #include "CommandOps.h"
+#include "ImportRaw.h"
+#include "PaletteMap.h"
+#include "Parallel.h"
+#include "Probe.h"
 #include "TacentView.h"
 
 
@@ -38,6 +47,7 @@ namespace Command
 	tCmdLine::tOption OptionExamples		("Print examples",					"examples",		'x'			);
 	tCmdLine::tOption OptionMarkdown		("Print examples in markdown",		"markdown",		'm'			);
 	tCmdLine::tOption OptionVerbosity		("Verbosity from 0 to 2",			"verbosity",	'v',	1	);
+	tCmdLine::tOption OptionBenchPalette	("Check and time palette mapping",	"benchPalette",			0	);
 
 	tCmdLine::tOption OptionInTypes			("Input file type(s)",				"in",			'i',	1	);
 	tCmdLine::tOption OptionInASTC			("Load parameters for ASTC files",	"inASTC",				1	);
@@ -48,6 +58,7 @@ namespace Command
 	tCmdLine::tOption OptionInKTX			("Load parameters for KTX files",	"inKTX",				1	);
 	tCmdLine::tOption OptionInPKM			("Load parameters for PKM files",	"inPKM",				1	);
 	tCmdLine::tOption OptionInPNG			("Load parameters for PNG files",	"inPNG",				1	);
+	tCmdLine::tOption OptionInRAW			("Import inputs as raw pixel data",	"inRAW",				1	);
 
 	tCmdLine::tOption OptionOperation		("Operation",						"op",					1	);
 	tCmdLine::tOption OptionPostOperation	("Post operation",					"po",					1	);
@@ -97,6 +108,8 @@ namespace Command
 	void ParseLoadParametersKTX();
 	void ParseLoadParametersPKM();
 	void ParseLoadParametersPNG();
+	void ParseLoadParametersRAW();
+	tImage::tPixelFormat GetPixelFormatFromName(const tString&);
 
 	void DetermineInputFiles();																	// Step 2.
 	void GetItemsFromManifest(tList<tStringItem>& manifestItems, const tString& manifestFile);
@@ -106,6 +119,11 @@ namespace Command
 	void PopulatePostOperations();
 	void PopulateImagesList();																	// Step 3.
 	bool ProcessOperationsOnImage(Viewer::Image&);												// Applies all the operations (in order) to the supplied image.
+	int SaveImageToOutTypes(Viewer::Image&);													// Returns an error code. Success if all saved.
+
+	// JPG to JPG where every operation is a 90 degree rotation or a flip is done on the compressed data without
+	// decoding. Returns false if the image needs the normal load, process and save. If true, result is the error code.
+	bool ProcessLosslessJPG(Viewer::Image&, int& result);
 
 	void DetermineOutputTypes();																// Step 4.
 	void DetermineOutputNameParameters();														// Step 5.
@@ -122,9 +140,30 @@ namespace Command
 
 	tString DetermineOutputFilename(const tString& inName, tSystem::tFileType outType);
 
+	// Raw pixel import. When --inRAW is present every input file, whatever its extension, is treated as raw pixel
+	// data described by these parameters. A file may hold many consecutive images (frames), each with the same
+	// number of surfaces or mipmaps.
+	struct RawParams
+	{
+		int Width							= 0;
+		int Height							= 0;
+		int Offset							= 0;
+		tImage::tPixelFormat PixelFormat	= tImage::tPixelFormat::R8G8B8A8;
+		bool Mipmaps						= false;
+		int SurfaceOrMipmapCount			= 1;
+		tColourSpace ColourSpace			= tColourSpace::sRGB;
+		bool ReverseRows					= false;
+		bool PremultAlpha					= false;
+		int NumFrames						= 1;				// -1 means as many as fit in the file.
+	};
+	RawParams ParamsRAW;
+	int ProcessRawImports();																	// Replaces steps 3 onwards for raw input.
+	int ProcessRawFile(const tSystem::tFileInfo&);												// Returns an error code. Thread-safe.
+
 	tImage::tImageAPNG::SaveParams	SaveParamsAPNG;
 	tImage::tImageBMP::SaveParams	SaveParamsBMP;
 	tImage::tImageGIF::SaveParams	SaveParamsGIF;
+	GifPalette::Mode				SaveParamsGIFPalette = GifPalette::Mode::PerFrame;
 	tImage::tImageJPG::SaveParams	SaveParamsJPG;
 	tImage::tImagePNG::SaveParams	SaveParamsPNG;
 	tImage::tImageQOI::SaveParams	SaveParamsQOI;
@@ -374,10 +413,12 @@ void Command::ParseInputItem(tList<tSystem::tFileInfo>& inputFiles, const tStrin
 
 	if (info.Directory)
 	{
-		if (item == ".")
-			tSystem::tFindFiles(inputFiles, "", InputTypes);
+		// Raw input files can have any extension so all files in the directory are used.
+		tString dir = (item == ".") ? tString() : item;
+		if (OptionInRAW)
+			tSystem::tFindFiles(inputFiles, dir);
 		else
-			tSystem::tFindFiles(inputFiles, item, InputTypes);
+			tSystem::tFindFiles(inputFiles, dir, InputTypes);
 	}
 	else
 	{
@@ -385,9 +426,10 @@ void Command::ParseInputItem(tList<tSystem::tFileInfo>& inputFiles, const tStrin
 		info.FileName = tSystem::tGetAbsolutePath(info.FileName);
 
 		// Add existing files that are of a globally supported filetype. Note we ignore InputTypes
-		// here because the user explicitely specified the file, so it must be what they want.
+		// here because the user explicitely specified the file, so it must be what they want. Any file
+		// may be imported as raw pixel data.
 		tSystem::tFileType typ = tSystem::tGetFileType(item);
-		if (Viewer::FileTypes_Load.Contains(typ))
+		if (OptionInRAW || Viewer::FileTypes_Load.Contains(typ))
 			inputFiles.Append(new tSystem::tFileInfo(info));
 	}
 }
@@ -749,13 +791,111 @@ void Command::ParseLoadParametersPNG()
 }
 
 
+void Command::ParseLoadParametersRAW()
+{
+	tList<ParamValuePair> pairs;
+	ParseParamValuePairs(pairs, OptionInRAW.Arg1());
+	for (ParamValuePair* p = pairs.First(); p; p = p->Next())
+	{
+		tString& param = p->Param;
+		tString& value = p->Value;
+		switch (tHash::tHashString(param.Chr()))
+		{
+			case tHash::tHashCT("w"):
+				ParamsRAW.Width = (value == "*") ? 0 : tMath::tClamp(value.AsInt(), 0, Viewer::Image::MaxDim);
+				break;
+
+			case tHash::tHashCT("h"):
+				ParamsRAW.Height = (value == "*") ? 0 : tMath::tClamp(value.AsInt(), 0, Viewer::Image::MaxDim);
+				break;
+
+			case tHash::tHashCT("offs"):
+				ParamsRAW.Offset = (value == "*") ? 0 : tMath::tClampMin(value.AsInt(), 0);
+				break;
+
+			case tHash::tHashCT("fmt"):
+			{
+				tImage::tPixelFormat fmt = (value == "*") ? tImage::tPixelFormat::R8G8B8A8 : GetPixelFormatFromName(value);
+				if (fmt == tImage::tPixelFormat::Invalid)
+					tPrintfNorm("Warning: Unknown raw pixel format: %s\n", value.Chr());
+				else
+					ParamsRAW.PixelFormat = fmt;
+				break;
+			}
+
+			case tHash::tHashCT("mips"):
+				ParamsRAW.Mipmaps = (value != "*") && (value.AsInt() > 1);
+				ParamsRAW.SurfaceOrMipmapCount = (value == "*") ? 1 : tMath::tClamp(value.AsInt(), 1, 128);
+				break;
+
+			case tHash::tHashCT("surf"):
+				ParamsRAW.Mipmaps = false;
+				ParamsRAW.SurfaceOrMipmapCount = (value == "*") ? 1 : tMath::tClamp(value.AsInt(), 1, 128);
+				break;
+
+			case tHash::tHashCT("colp"):
+				switch (tHash::tHashString(value.Chr()))
+				{
+					case tHash::tHashCT("*"):
+					case tHash::tHashCT("sRGB"):	ParamsRAW.ColourSpace = tColourSpace::sRGB;	break;
+					case tHash::tHashCT("lRGB"):	ParamsRAW.ColourSpace = tColourSpace::lRGB;	break;
+				}
+				break;
+
+			case tHash::tHashCT("rev"):
+				ParamsRAW.ReverseRows = (value == "*") ? false : value.AsBool();
+				break;
+
+			case tHash::tHashCT("pmul"):
+				ParamsRAW.PremultAlpha = (value == "*") ? false : value.AsBool();
+				break;
+
+			case tHash::tHashCT("frames"):
+				ParamsRAW.NumFrames = (value == "*") ? -1 : tMath::tClampMin(value.AsInt(), 1);
+				break;
+		}
+	}
+}
+
+
+tImage::tPixelFormat Command::GetPixelFormatFromName(const tString& name)
+{
+	// The raw import supports the same formats as the GUI. That is, packed, BC, PVR, and ASTC.
+	struct FormatRange { tImage::tPixelFormat First; int Count; };
+	const FormatRange ranges[] =
+	{
+		{ tImage::tPixelFormat::FirstPacked,	int(tImage::tPixelFormat::NumPackedFormats)	},
+		{ tImage::tPixelFormat::FirstBC,		int(tImage::tPixelFormat::NumBCFormats)		},
+		{ tImage::tPixelFormat::FirstPVR,		int(tImage::tPixelFormat::NumPVRFormats)	},
+		{ tImage::tPixelFormat::FirstASTC,		int(tImage::tPixelFormat::NumASTCFormats)	}
+	};
+
+	for (const FormatRange& range : ranges)
+	{
+		for (int f = 0; f < range.Count; f++)
+		{
+			tImage::tPixelFormat fmt = tImage::tPixelFormat(int(range.First) + f);
+			if (name.IsEqualCI(tImage::tGetPixelFormatName(fmt)))
+				return fmt;
+		}
+	}
+
+	return tImage::tPixelFormat::Invalid;
+}
+
+
 void Command::DetermineInputFiles()
 {
 	tList<tSystem::tFileInfo> inputFiles;
 
 	// If no input files specified, use the current directory.
 	if (!ParamInputFiles)
-		tSystem::tFindFiles(inputFiles, "", InputTypes);
+	{
+		if (OptionInRAW)
+			tSystem::tFindFiles(inputFiles, "");
+		else
+			tSystem::tFindFiles(inputFiles, "", InputTypes);
+	}
 
 	for (tStringItem* fileItem = ParamInputFiles.Values.First(); fileItem; fileItem = fileItem->Next())
 	{
@@ -1001,7 +1141,7 @@ void Command::SetImageSaveParameters(Viewer::Image& image, tSystem::tFileType fi
 	{
 		case tSystem::tFileType::APNG: image.SaveParamsAPNG = SaveParamsAPNG; break;
 		case tSystem::tFileType::BMP:  image.SaveParamsBMP  = SaveParamsBMP;  break;
-		case tSystem::tFileType::GIF:  image.SaveParamsGIF  = SaveParamsGIF;  break;
+		case tSystem::tFileType::GIF:  image.SaveParamsGIF  = SaveParamsGIF;  image.SaveParamsGIFPalette = SaveParamsGIFPalette;  break;
 		case tSystem::tFileType::JPG:  image.SaveParamsJPG  = SaveParamsJPG;  break;
 		case tSystem::tFileType::PNG:  image.SaveParamsPNG  = SaveParamsPNG;  break;
 		case tSystem::tFileType::QOI:  image.SaveParamsQOI  = SaveParamsQOI;  break;
@@ -1126,6 +1266,16 @@ void Command::ParseSaveParametersGIF()
 			case tHash::tHashCT("samp"):
 				SaveParamsGIF.SampleFactor = (value == "*") ? 1 : value.AsInt32();
 				break;
+
+			case tHash::tHashCT("pal"):
+				switch (tHash::tHashString(value.Chr()))
+				{
+					case tHash::tHashCT("glb"):	SaveParamsGIFPalette = GifPalette::Mode::Global;		break;
+					case tHash::tHashCT("adp"):	SaveParamsGIFPalette = GifPalette::Mode::Adaptive;		break;
+					case tHash::tHashCT("frm"):
+					case tHash::tHashCT("*"):	SaveParamsGIFPalette = GifPalette::Mode::PerFrame;		break;
+				}
+				break;
 		}
 	}
 }
@@ -1319,7 +1469,11 @@ tString Command::DetermineOutputFilename(const tString& inName, tSystem::tFileTy
 	if (!OptionAutoName)
 		return outName;
 
-	// Autoname is true. Test up to 100 consecutive filenames.
+	// Autoname is true. Test up to 100 consecutive filenames. Images may be saved from worker threads so the test and
+	// the claim happen under a lock. A claimed name counts as taken even though its file has not been written yet.
+	static std::mutex autoNameMutex;
+	static std::set<std::string> autoNamesClaimed;
+	const std::lock_guard<std::mutex> lock(autoNameMutex);
 	for (int nameIter = 0; nameIter < 100; nameIter++)
 	{
 		tString contender;
@@ -1328,7 +1482,7 @@ tString Command::DetermineOutputFilename(const tString& inName, tSystem::tFileTy
 		else
 			tsPrintf(contender, "%s%s_%03d.%s", tSystem::tGetDir(inName).Chr(), baseName.Chr(), nameIter, outExt.Chr());
 
-		if (!tSystem::tFileExists(contender))
+		if (!tSystem::tFileExists(contender) && autoNamesClaimed.insert(contender.Chr()).second)
 			return contender;
 	}
 
@@ -1336,6 +1490,255 @@ tString Command::DetermineOutputFilename(const tString& inName, tSystem::tFileTy
 }
 
 
+int Command::SaveImageToOutTypes(Viewer::Image& image)
+{
+	bool somethingFailed = false;
+	tAssert(OutTypes.Count() >= 1);
+	for (tSystem::tFileTypes::tFileTypeItem* typeItem = OutTypes.First(); typeItem; typeItem = typeItem->Next())
+	{
+		tSystem::tFileType outType = typeItem->FileType;
+
+		// Determine out filename.
+		tString outFilename = DetermineOutputFilename(image.Filename, outType);
+		tString outNameShort = tSystem::tGetFileName(outFilename);
+		if (!OptionOverwrite && tSystem::tFileExists(outFilename))
+		{
+			tPrintfNorm("Warning: %s exists. No overwrite.\n", outNameShort.Chr());
+			somethingFailed = true;
+			if (OptionEarlyExit)
+				return Viewer::ErrorCode_CLI_FailEarlyExit;
+			continue;
+		}
+
+		// Set the image save parameters correctly. The user may have modified them from the command line.
+		SetImageSaveParameters(image, outType);
+		bool success = image.Save(outFilename, outType, false);
+		if (success)
+		{
+			tPrintfNorm("Saved File: %s\n", outNameShort.Chr());
+		}
+		else
+		{
+			tPrintfNorm("Warning: Failed save: %s\n", outNameShort.Chr());
+			somethingFailed = true;
+			if (OptionEarlyExit)
+				return Viewer::ErrorCode_CLI_FailImageSave;
+		}
+	}
+
+	return somethingFailed ? Viewer::ErrorCode_CLI_FailUnknown : Viewer::ErrorCode_Success;
+}
+
+
+bool Command::ProcessLosslessJPG(Viewer::Image& image, int& result)
+{
+	// Any JPG save parameters given on the command line mean a re-encode is wanted.
+	if ((image.Filetype != tSystem::tFileType::JPG) || (OutTypes.Count() != 1) || !OutTypes.Contains(tSystem::tFileType::JPG) || OptionOutJPG)
+		return false;
+
+	std::vector<tImage::tImageJPG::Transform> transforms;
+	for (Operation* operation = Operations.First(); operation; operation = operation->Next())
+	{
+		if (!operation->Valid)
+			continue;
+		if (!operation->GetLosslessTransformsJPG(transforms))
+			return false;
+	}
+	if (transforms.empty())
+		return false;
+
+	// A normal load applies the EXIF orientation but the compressed data is stored unrotated. Only files that don't
+	// need reorienting give the same result both ways.
+	if (LoadParamsJPG.Flags & tImage::tImageJPG::LoadFlag_ExifOrient)
+	{
+		Probe::Result probe;
+		Probe::ProbeFile(probe, image.Filename, tSystem::tFileType::JPG, false);
+		if (probe.MetaData.IsValid())
+		{
+			const tImage::tMetaDatum& orientation = probe.MetaData[tImage::tMetaTag::Orientation];
+			if (orientation.IsSet() && (orientation.Uint32 > 1))
+				return false;
+		}
+	}
+
+	tImage::tImageJPG jpg;
+	tImage::tImageJPG::LoadParams params;
+	params.Flags = tImage::tImageJPG::LoadFlag_NoDecompress;
+	jpg.Load(image.Filename, params);
+	if (!jpg.IsValid())
+		return false;
+
+	// An imperfect transform would trim the right or bottom edge. The normal path keeps every pixel so use it instead.
+	tString inNameShort = tSystem::tGetFileName(image.Filename);
+	for (tImage::tImageJPG::Transform transform : transforms)
+	{
+		if (!jpg.CanDoPerfectLosslessTransform(transform))
+		{
+			tPrintfFull("Lossless JPG transform not possible for %s. Dimensions not a multiple of the MCU size.\n", inNameShort.Chr());
+			return false;
+		}
+		jpg.LosslessTransform(transform);
+	}
+
+	tPrintfNorm("Processing: %s\n", inNameShort.Chr());
+	tPrintfFull("Lossless JPG | Transforms[count:%d]\n", int(transforms.size()));
+	result = Viewer::ErrorCode_Success;
+	tString outFilename = DetermineOutputFilename(image.Filename, tSystem::tFileType::JPG);
+	tString outNameShort = tSystem::tGetFileName(outFilename);
+	if (!OptionOverwrite && tSystem::tFileExists(outFilename))
+	{
+		tPrintfNorm("Warning: %s exists. No overwrite.\n", outNameShort.Chr());
+		result = OptionEarlyExit ? Viewer::ErrorCode_CLI_FailEarlyExit : Viewer::ErrorCode_CLI_FailUnknown;
+		return true;
+	}
+
+	if (jpg.Save(outFilename))
+	{
+		tPrintfNorm("Saved File: %s\n", outNameShort.Chr());
+	}
+	else
+	{
+		tPrintfNorm("Warning: Failed save: %s\n", outNameShort.Chr());
+		result = OptionEarlyExit ? Viewer::ErrorCode_CLI_FailImageSave : Viewer::ErrorCode_CLI_FailUnknown;
+	}
+	return true;
+}
+
+
+int Command::ProcessRawImports()
+{
+	if ((ParamsRAW.Width <= 0) || (ParamsRAW.Height <= 0))
+	{
+		tPrintfNorm("Warning: Raw import requires a width and height. eg. --inRAW w=640,h=480\n");
+		return Viewer::ErrorCode_CLI_FailImageLoad;
+	}
+
+	if (!PostOperations.IsEmpty())
+		tPrintfNorm("Warning: Post operations are not supported with raw import. Skipping.\n");
+
+	std::vector<const tSystem::tFileInfo*> files;
+	for (tSystem::tFileInfo* info = InputFiles.First(); info; info = info->Next())
+		files.push_back(info);
+
+	// Thousands of small dumps are typical so whole files are handed out to the workers. With early-exit the first
+	// failure stops any more files from being started.
+	std::atomic<int> firstError { Viewer::ErrorCode_Success };
+	Parallel::For
+	(
+		int(files.size()),
+		[&](int f)
+		{
+			if (OptionEarlyExit && (firstError != Viewer::ErrorCode_Success))
+				return;
+
+			int result = ProcessRawFile(*files[f]);
+			int expected = Viewer::ErrorCode_Success;
+			if (result != Viewer::ErrorCode_Success)
+				firstError.compare_exchange_strong(expected, result);
+		}
+	);
+
+	if (firstError == Viewer::ErrorCode_Success)
+		return Viewer::ErrorCode_Success;
+
+	return OptionEarlyExit ? int(firstError) : Viewer::ErrorCode_CLI_FailUnknown;
+}
+
+
+int Command::ProcessRawFile(const tSystem::tFileInfo& info)
+{
+	const RawParams& params = ParamsRAW;
+	tString inNameShort = tSystem::tGetFileName(info.FileName);
+	int frameSize = ImportRaw::GetRawDataSize(params.PixelFormat, params.Width, params.Height, params.Mipmaps, params.SurfaceOrMipmapCount);
+	int64 dataHave = int64(info.FileSize) - params.Offset;
+	int numFrames = (frameSize > 0) ? int(tMath::tClampMin(dataHave, int64(0)) / frameSize) : 0;
+	if (params.NumFrames > 0)
+	{
+		if (numFrames < params.NumFrames)
+			numFrames = 0;
+		else
+			numFrames = params.NumFrames;
+	}
+
+	if (numFrames <= 0)
+	{
+		tPrintfNorm("Warning: Not enough raw data in %s. Skipping.\n", inNameShort.Chr());
+		return Viewer::ErrorCode_CLI_FailImageLoad;
+	}
+
+	// The frames are read one at a time so memory use depends on the frame size, not the file size. A multi-gigabyte
+	// capture holding many consecutive frames is streamed through a single frame-sized buffer.
+	tSystem::tFileHandle file = tSystem::tOpenFile(info.FileName.Chr(), "rb");
+	if (!file || ((params.Offset > 0) && (tSystem::tFileSeek(file, params.Offset) != 0)))
+	{
+		if (file)
+			tSystem::tCloseFile(file);
+		tPrintfNorm("Warning: Failed to open %s. Skipping.\n", inNameShort.Chr());
+		return Viewer::ErrorCode_CLI_FailImageLoad;
+	}
+
+	// APNG and WEBP frames must all be the same size so mipmaps are padded for them.
+	bool forceSameFrameSize = OutTypes.Contains(tSystem::tFileType::APNG) || OutTypes.Contains(tSystem::tFileType::WEBP);
+	uint8* buffer = new uint8[frameSize];
+	int result = Viewer::ErrorCode_Success;
+	for (int frameNum = 0; frameNum < numFrames; frameNum++)
+	{
+		// Multi-frame files get an output file per frame. The extension is replaced when the output name is made.
+		tString frameName = info.FileName;
+		if (numFrames > 1)
+			tsPrintf(frameName, "%s%s_%04d.raw", tSystem::tGetDir(info.FileName).Chr(), tSystem::tGetFileBaseName(info.FileName).Chr(), frameNum);
+		tString frameNameShort = tSystem::tGetFileName(frameName);
+
+		tList<tImage::tFrame> frames;
+		ImportRaw::CreateResult created = ImportRaw::CreateResult::DataShortage;
+		if (tSystem::tReadFile(file, buffer, frameSize) == frameSize)
+		{
+			created = ImportRaw::CreateFrames
+			(
+				frames, buffer, frameSize, params.PixelFormat,
+				params.Width, params.Height,
+				params.Mipmaps, forceSameFrameSize, params.SurfaceOrMipmapCount,
+				params.PremultAlpha, params.ColourSpace, params.ReverseRows
+			);
+		}
+
+		if (created != ImportRaw::CreateResult::Success)
+		{
+			tPrintfNorm("Warning: Failed raw import: %s. Skipping.\n", frameNameShort.Chr());
+			result = Viewer::ErrorCode_CLI_FailImageLoad;
+			if (OptionEarlyExit)
+				break;
+			continue;
+		}
+
+		Viewer::Image image(frameName);
+		image.SetUndoEnabled(false);
+		image.Set(frames);
+
+		tPrintfNorm("Processing: %s\n", frameNameShort.Chr());
+		if (!ProcessOperationsOnImage(image))
+		{
+			result = Viewer::ErrorCode_CLI_FailImageProcess;
+			if (OptionEarlyExit)
+				break;
+			continue;
+		}
+
+		int saveResult = SaveImageToOutTypes(image);
+		if (saveResult != Viewer::ErrorCode_Success)
+		{
+			result = saveResult;
+			if (OptionEarlyExit)
+				break;
+		}
+	}
+
+	delete[] buffer;
+	tSystem::tCloseFile(file);
+	return result;
+}
+
+
 int Command::Process()
 {
 	ConsoleOutputScoped scopedConsoleOutput;
@@ -1404,13 +1807,29 @@ int Command::Process()
 		return Viewer::ErrorCode_Success;
 	}
 
+	if (OptionBenchPalette)
+		return Viewer::PaletteMap::Benchmark() ? Viewer::ErrorCode_Success : Viewer::ErrorCode_CLI_FailUnknown;
+
 	// Determine what input types will be processed when specifying a directory.
 	DetermineInputTypes();
 	DetermineInputLoadParameters();
+	if (OptionInRAW)
+		ParseLoadParametersRAW();
 
 	// Collect all input files into a single list.
 	DetermineInputFiles();
 
+	// Raw imports don't go through the Images list. Each input is decoded, operated on, and saved by a worker.
+	if (OptionInRAW)
+	{
+		PopulateOperations();
+		PopulatePostOperations();
+		DetermineOutputTypes();
+		DetermineOutputNameParameters();
+		DetermineOutputSaveParameters();
+		return ProcessRawImports();
+	}
+
 	// Populates the Images list. Each added image gets its load-parameters set correctly and the undo-stack turned
 	// off. Does not load the images.
 	PopulateImagesList();
@@ -1431,6 +1850,19 @@ int Command::Process()
 	bool somethingFailed = false;
 	for (Viewer::Image* image = Images.First(); image; image = image->Next())
 	{
+		// Rotations by 90 and flips of JPGs going to JPG don't need a decode at all.
+		int losslessResult = Viewer::ErrorCode_Success;
+		if (ProcessLosslessJPG(*image, losslessResult))
+		{
+			if (losslessResult != Viewer::ErrorCode_Success)
+			{
+				somethingFailed = true;
+				if (OptionEarlyExit)
+					return losslessResult;
+			}
+			continue;
+		}
+
 		// We do not read the config file when using the CLI. All parameters need to com from the command-line.
 		bool loadParamsFromConfig = false;
 		image->Load(loadParamsFromConfig);
@@ -1468,45 +1900,14 @@ int Command::Process()
 		}
 
 		// Now we iterate through the output types, saving if needed.
-		tAssert(OutTypes.Count() >= 1);
-		for (tSystem::tFileTypes::tFileTypeItem* typeItem = OutTypes.First(); typeItem; typeItem = typeItem->Next())
+		int saveResult = SaveImageToOutTypes(*image);
+		image->Unload();
+		if (saveResult != Viewer::ErrorCode_Success)
 		{
-			tSystem::tFileType outType = typeItem->FileType;
-
-			// Determine out filename.
-			tString outFilename = DetermineOutputFilename(image->Filename, outType);
-			tString outNameShort = tSystem::tGetFileName(outFilename);
-			if (!OptionOverwrite && tSystem::tFileExists(outFilename))
-			{
-				tPrintfNorm("Warning: %s exists. No overwrite.\n", outNameShort.Chr());
-				somethingFailed = true;
-				if (OptionEarlyExit)
-				{
-					image->Unload();
-					return Viewer::ErrorCode_CLI_FailEarlyExit;
-				}
-				continue;
-			}
-
-			// Set the image save parameters correctly. The user may have modified them from the command line.
-			SetImageSaveParameters(*image, outType);
-			bool success = image->Save(outFilename, outType, false);
-			if (success)
-			{
-				tPrintfNorm("Saved File: %s\n", outNameShort.Chr());
-			}
-			else
-			{
-				tPrintfNorm("Warning: Failed save: %s\n", outNameShort.Chr());
-				somethingFailed = true;
-				if (OptionEarlyExit)
-				{
-					image->Unload();
-					return Viewer::ErrorCode_CLI_FailImageSave;
-				}
-			}
+			somethingFailed = true;
+			if (OptionEarlyExit)
+				return saveResult;
 		}
-		image->Unload();
 	}
 
 	// Do post save operations here --po. These are operations that take more than a single image as input.
@@ -18,6 +18,7 @@
 #include <System/tPrint.h>
 #include <System/tCmdLine.h>
 #include "Image.h"
+#include "GifPalette.h"
 
 
 namespace Command
@@ -46,6 +47,7 @@ namespace Command
 	extern tImage::tImageTGA::SaveParams  SaveParamsTGA;
 	extern tImage::tImageTIFF::SaveParams SaveParamsTIFF;
 	extern tImage::tImageWEBP::SaveParams SaveParamsWEBP;
+	extern GifPalette::Mode SaveParamsGIFPalette;
 
 	void SetImageSaveParameters(Viewer::Image&, tSystem::tFileType);
 }
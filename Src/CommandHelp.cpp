@@ -827,6 +827,11 @@ example 'tacentview -cm > markdown.md'
 Set output verbosity with --verbosity (-v) and a single integer value after it
 from 0 to 2. 0 means no text output, 1 is the default, and 2 is full/detailed.
 
+The --benchPalette flag checks the nearest-colour lookup used by the fixed
+quantizer and shared GIF palettes against a brute-force search for every
+24-bit colour, and prints how long each takes. Call 'tacentview -c
+--benchPalette'. A non-zero exit code means a lookup did not match.
+
 To launch in GUI mode run without any arguments or with the file or directory
 you want to open as the argument. Directories should be specified with a
 trailing slash. You may optionally specify the profile to use with the
@@ -1003,6 +1008,28 @@ are sufficient. Image types with load parameters:
         inside a regular PNG file. This allows the command-line to load all
         the frames of an APNG file even if it has a regular (single-frame)
         png extension.
+
+--inRAW
+  Unlike the other load parameters, --inRAW treats every input file as raw
+  pixel data regardless of extension. When a directory is specified all files
+  in it are imported. Files are processed in parallel. Post operations are not
+  supported.
+  w:    Width in pixels. Required.
+  h:    Height in pixels. Required.
+  offs: Byte offset to the start of the pixel data. Default 0*.
+  fmt:  Pixel format name. Packed, BC, PVR, and ASTC formats are supported.
+        Case insensitive. Default is R8G8B8A8*. eg. fmt=BC1DXT1
+  mips: Number of mipmaps in each image. Default 1* (no mipmaps).
+  surf: Number of same-size surfaces (frames) in each image. Default 1*.
+  colp: Colour profile. Possible values:
+        sRGB* - Pixel data is in sRGB space.
+        lRGB  - Pixel data is in linear space.
+  rev:  Reverse row order. Boolean true or false*.
+  pmul: Pixel data has premultiplied alpha. Boolean true or false*.
+  frames:Number of consecutive images stored in each file. Default 1*. If set
+        to * as many images as fit in the file are imported. Files with more
+        than one image are read one image at a time and each is saved as a
+        separate output file with a _NNNN suffix.
 )LOADPARAMS010"
 	);
 	tPrintf
@@ -1044,7 +1071,7 @@ or leave it out. Eg. zap[a*,b*] may be called with --op zap[] or just --op zap.
         valid channel should be specified otherwise the default is used. Eg. RG
         sets the red and green channels. abG sets alpha, blue, and green.
 
---op resize[w,h,filt*,edge*]
+--op resize[w,h,filt*,edge*,gam*]
   Resizes image by resampling. Allows non-uniform scale.
   w:    Width. An int in range [4, %d], 0*, or -1. If set to 0 or -1 it
         preserves the aspect ratio by using the height and original aspect.
@@ -1054,6 +1081,10 @@ or leave it out. Eg. zap[a*,b*] may be called with --op zap[] or just --op zap.
         for the image being processed. See below for valid filter names.
   edge: Edge mode. Default is clamp*. Only used if dimensions changed for the
         image being processed. See note below for valid edge mode names.
+  gam:  Boolean gamma-correct. Default is false*. With the box filter, a
+        reduction by a whole-number factor in each direction (2x, 4x, etc) uses
+        a fast area average. If gam is true that average is done in linear
+        light. Ignored for other filters and ratios.
 
 --op canvas[w,h,anc*,fill*,ancx*,ancy*]
   Resizes image by modifying the canvas area of the image. You specify the new
@@ -1137,7 +1168,11 @@ or leave it out. Eg. zap[a*,b*] may be called with --op zap[] or just --op zap.
         trans* (transparent black).
 
 --op flip[mode*]
-  Flips an image either horizontally or vertically.
+  Flips an image either horizontally or vertically. If the input and the only
+  output type are JPG and every operation is a flip or exact 90/180 degree
+  rotation, the transform is applied to the compressed data without any loss.
+  This is not done if --outJPG is given or if the image size is not a multiple
+  of the JPG block size.
   mode: Either horizontal or vertical. Synonyms include h, v, H, V, Horizontal
         and Vertical. If mode not specified or specified as *, default is
         horizontal* which is about the vertical axis (left becomes right and
@@ -1157,6 +1192,7 @@ or leave it out. Eg. zap[a*,b*] may be called with --op zap[] or just --op zap.
         For 90 Degree Anticlockwise :  90  90.0 acw ccw
         For 90 Degree Clockwise     : -90 -90.0 cw
         For 180 Degree Rotation     : 180 180.0
+        Exact rotations of JPGs saved as JPG may be lossless. See flip.
   mode: Rotation mode. One of fill, crop*, or resize. Fill mode will result in
         larger images and the fill-colour is used because the image bounds get
         rotated outside of the original area. Preserves all image content. Crop
@@ -1171,7 +1207,10 @@ or leave it out. Eg. zap[a*,b*] may be called with --op zap[] or just --op zap.
         much better results. It is also valid to enter 'none' in which case no
         scaling-up of the image is performed. In this case all original pixel
         colours are preserved by using nearest neighbour colours. This is fast
-        and a good choice for pixel-art and sprites.
+        and a good choice for pixel-art and sprites. For bilinear and the
+        bicubic_catmullrom, bicubic_mitchell and bicubic_bspline filters the
+        rotation samples the original image directly with that filter on all
+        cores, skipping the up and down scaling, and dnft is not used.
   dnft: Downsample filter. Only used if up-filter is not none. This filter is
         used to restore image size after rotation. Specifying none* here uses
         a special down-sample method that produces sharper results. Using box
@@ -1529,6 +1568,13 @@ with save parameters:
   samp: Sample factor. Range is [1,30]. Only applies to neu quantization. 1*
         means whole image learning. 10 means 1/10 of image only. Max value 30
         is fastest.
+  pal:  Palette sharing for animated GIFs. Possible values:
+        frm*  - Every frame gets its own palette. Best quality.
+        glb   - One palette is built from a sample of all frames and used for
+                every frame. Much faster for long, similar-looking animations.
+        adp   - A frame reuses the previous palette unless its colour
+                histogram changed noticeably.
+        The glb and adp modes do not dither.
 
 --outJPG
   qual: Quality of jpeg in range [1,100]. Default is 95*
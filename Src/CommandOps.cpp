@@ -25,6 +25,8 @@
 #include "Command.h"
 #include "MultiFrame.h"
 #include "OpenSaveDialogs.h"
+#include "Quantize.h"
+#include "Resampler.h"
 #include "TacentView.h"
 
 
@@ -206,6 +208,12 @@ Command::OperationResize::OperationResize(const tString& argsStr)
 		}
 	}
 
+	if (numArgs >= 5)
+	{
+		currArg = currArg->Next();
+		GammaCorrect = currArg->AsBool();
+	}
+
 	Valid = true;
 }
 
@@ -237,8 +245,15 @@ bool Command::OperationResize::Apply(Viewer::Image& image)
 		return true;
 	}
 
-	tPrintfFull("Resize | Resample[Dim:%dx%d Filter:%s EdgeMode:%s]\n", dstW, dstH, tImage::tResampleFilterNamesSimple[int(ResampleFilter)], tImage::tResampleEdgeModeNamesSimple[int(EdgeMode)]);
-	image.Resample(dstW, dstH, ResampleFilter, EdgeMode);
+	if ((ResampleFilter == tImage::tResampleFilter::Box) && Resampler::IsIntegerDownscale(srcW, srcH, dstW, dstH))
+	{
+		tPrintfFull("Resize | BoxDownscale[Dim:%dx%d Factor:%dx%d Gamma:%s]\n", dstW, dstH, srcW/dstW, srcH/dstH, GammaCorrect ? "true" : "false");
+	}
+	else
+	{
+		tPrintfFull("Resize | Resample[Dim:%dx%d Filter:%s EdgeMode:%s]\n", dstW, dstH, tImage::tResampleFilterNamesSimple[int(ResampleFilter)], tImage::tResampleEdgeModeNamesSimple[int(EdgeMode)]);
+	}
+	image.Resample(dstW, dstH, ResampleFilter, EdgeMode, GammaCorrect);
 	return true;
 }
 
@@ -678,6 +693,13 @@ bool Command::OperationFlip::Apply(Viewer::Image& image)
 }
 
 
+bool Command::OperationFlip::GetLosslessTransformsJPG(std::vector<tImage::tImageJPG::Transform>& transforms) const
+{
+	transforms.push_back((Mode == FlipMode::Horizontal) ? tImage::tImageJPG::Transform::FlipH : tImage::tImageJPG::Transform::FlipV);
+	return true;
+}
+
+
 Command::OperationRotate::OperationRotate(const tString& argsStr)
 {
 	tList<tStringItem> args;
@@ -834,13 +856,16 @@ bool Command::OperationRotate::Apply(Viewer::Image& image)
 
 	tPrintfFull
 	(
-		"Rotate | Rotate\n[\n  rad:%f deg:%f\n  upfilt:%s dnfilt:%s\n  fill:%02x,%02x,%02x,%02x\n]\n",
+		"Rotate | Rotate\n[\n  rad:%f deg:%f\n  upfilt:%s dnfilt:%s\n  fill:%02x,%02x,%02x,%02x\n  direct:%s\n]\n",
 		Angle, tMath::tRadToDeg(Angle),
 		tImage::tResampleFilterNamesSimple[int(FilterUp)],
 		tImage::tResampleFilterNamesSimple[int(FilterDown)],
-		FillColour.R, FillColour.G, FillColour.B, FillColour.A
+		FillColour.R, FillColour.G, FillColour.B, FillColour.A,
+		Resampler::IsRotateDirect(FilterUp, FilterDown) ? "true" : "false"
 	);
+	double startTime = tSystem::tGetTime();
 	image.Rotate(Angle, FillColour, FilterUp, FilterDown);
+	tPrintfFull("Rotate | Rotated to %dx%d in %.3fs\n", image.GetWidth(), image.GetHeight(), float(tSystem::tGetTime() - startTime));
 
 	if ((Mode == RotateMode::Crop) || (Mode == RotateMode::Resize))
 	{
@@ -886,6 +911,34 @@ bool Command::OperationRotate::Apply(Viewer::Image& image)
 }
 
 
+bool Command::OperationRotate::GetLosslessTransformsJPG(std::vector<tImage::tImageJPG::Transform>& transforms) const
+{
+	switch (Exact)
+	{
+		case ExactMode::Zero:
+			return true;
+
+		case ExactMode::ACW90:
+			transforms.push_back(tImage::tImageJPG::Transform::Rotate90ACW);
+			return true;
+
+		case ExactMode::CW90:
+			transforms.push_back(tImage::tImageJPG::Transform::Rotate90CW);
+			return true;
+
+		case ExactMode::R180:
+			transforms.push_back(tImage::tImageJPG::Transform::Rotate90ACW);
+			transforms.push_back(tImage::tImageJPG::Transform::Rotate90ACW);
+			return true;
+
+		case ExactMode::Off:
+		default:
+			break;
+	}
+	return false;
+}
+
+
 Command::OperationLevels::OperationLevels(const tString& argsStr)
 {
 	tList<tStringItem> args;
@@ -1854,6 +1907,21 @@ bool Command::PostOperationCombine::Apply(tList<Viewer::Image>& images)
 		{
 			case tSystem::tFileType::GIF:
 			{
+				const std::lock_guard<std::mutex> lock(Viewer::GetQuantizeMutex());
+
+				// Shared palettes modify the frames so a copy is used if other out types still need the originals.
+				if ((SaveParamsGIFPalette != GifPalette::Mode::PerFrame) && !allowStealFrames)
+				{
+					tList<tImage::tFrame> gifFrames;
+					for (tImage::tFrame* frame = frames.First(); frame; frame = frame->Next())
+						gifFrames.Append(new tImage::tFrame(*frame));
+					GifPalette::Apply(gifFrames, SaveParamsGIFPalette, SaveParamsGIF);
+					tImage::tImageGIF gif(gifFrames, true);
+					success = gif.Save(outFile, SaveParamsGIF);
+					break;
+				}
+
+				GifPalette::Apply(frames, SaveParamsGIFPalette, SaveParamsGIF);
 				tImage::tImageGIF gif(frames, allowStealFrames);
 				success = gif.Save(outFile, SaveParamsGIF);
 				break;
@@ -2168,6 +2236,7 @@ bool Command::PostOperationContact::Apply(tList<Viewer::Image>& images)
 
 			case tSystem::tFileType::GIF:
 			{
+				const std::lock_guard<std::mutex> lock(Viewer::GetQuantizeMutex());
 				tImage::tImageGIF gif(outPic, allowStealFrames);
 				success = gif.Save(outFile, SaveParamsGIF);
 				break;
@@ -17,8 +17,10 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #pragma once
+#include <vector>
 #include <Math/tInterval.h>
 #include <Image/tPicture.h>
+#include <Image/tImageJPG.h>
 #include <Image/tQuantize.h>
 #include "Image.h"
 namespace Command
@@ -29,6 +31,10 @@ namespace Command
 struct Operation : public tLink<Operation>
 {
 	virtual bool Apply(Viewer::Image&)					= 0;
+
+	// If the operation can be done on compressed JPG data, appends the equivalent lossless transforms (possibly none)
+	// and returns true. Returns false by default. Used to skip the decode and re-encode when going JPG to JPG.
+	virtual bool GetLosslessTransformsJPG(std::vector<tImage::tImageJPG::Transform>&) const									{ return false; }
 	virtual ~Operation()								{ }
 	bool Valid											= false;
 };
@@ -53,6 +59,7 @@ struct OperationResize : public Operation
 	int Height											= 0;
 	tImage::tResampleFilter ResampleFilter				= tImage::tResampleFilter::Bilinear;		// Optional.
 	tImage::tResampleEdgeMode EdgeMode					= tImage::tResampleEdgeMode::Clamp;			// Optional.
+	bool GammaCorrect									= false;									// Optional.
 
 	bool Apply(Viewer::Image&) override;
 };
@@ -121,6 +128,7 @@ struct OperationFlip : public Operation
 	FlipMode Mode										= FlipMode::Horizontal;						// Optional.
 
 	bool Apply(Viewer::Image&) override;
+	bool GetLosslessTransformsJPG(std::vector<tImage::tImageJPG::Transform>&) const override;
 };
 
 
@@ -144,6 +152,7 @@ struct OperationRotate : public Operation
 	tColour4b FillColour								= tColour4b::black;							// Optional.
 
 	bool Apply(Viewer::Image&) override;
+	bool GetLosslessTransformsJPG(std::vector<tImage::tImageJPG::Transform>&) const override;
 };
 
 
@@ -395,6 +395,7 @@ void Config::ProfileData::Reset(Viewer::Profile profile, uint32 categories)
 		SaveFileGifDitherLevel		= 0.0f;
 		SaveFileGifFilterSize		= 1;
 		SaveFileGifSampleFactor		= 1;
+		SaveFileGifPaletteMode		= 0;
 		SaveFileWebpDurOverride		= -1;
 		SaveFileGifDurOverride		= -1;
 		SaveFileApngDurOverride		= -1;
@@ -466,6 +467,8 @@ void Config::ProfileData::Reset(Viewer::Profile profile, uint32 categories)
 		StrictLoading				= false;
 		MetaDataOrientLoading		= true;
 		DetectAPNGInsidePNG			= true;
+		DeltaFrameStorage			= false;
+		KeepTexturesCompressed		= false;
 		MipmapFilter				= int(tImage::tResampleFilter::Bilinear);
 		MipmapChaining				= true;
 		MonitorGamma				= tMath::DefaultGamma;
@@ -590,6 +593,7 @@ void Config::ProfileData::Load(tExpression expr)
 			ReadItem(SaveFileGifDitherLevel);
 			ReadItem(SaveFileGifFilterSize);
 			ReadItem(SaveFileGifSampleFactor);
+			ReadItem(SaveFileGifPaletteMode);
 
 			ReadItem(SaveFileWebpDurOverride);
 			ReadItem(SaveFileGifDurOverride);
@@ -636,6 +640,8 @@ void Config::ProfileData::Load(tExpression expr)
 			ReadItem(StrictLoading);
 			ReadItem(MetaDataOrientLoading);
 			ReadItem(DetectAPNGInsidePNG);
+			ReadItem(DeltaFrameStorage);
+			ReadItem(KeepTexturesCompressed);
 			ReadItem(MipmapFilter);
 			ReadItem(MipmapChaining);
 			ReadItem(AutoPropertyWindow);
@@ -696,6 +702,7 @@ void Config::ProfileData::Load(tExpression expr)
 	tiClampMin	(SaveFileGifDitherLevel, 0.0f);
 	tiClamp		(SaveFileGifFilterSize, 0, 2);
 	tiClamp		(SaveFileGifSampleFactor, 1, 10);
+	tiClamp		(SaveFileGifPaletteMode, 0, 2);
 
 	tiClampMin	(SaveFileWebpDurOverride, -1);
 	tiClampMin	(SaveFileGifDurOverride, -1);
@@ -792,6 +799,7 @@ bool Config::ProfileData::Save(tExprWriter& writer) const
 	WriteItem(SaveFileGifDitherLevel);
 	WriteItem(SaveFileGifFilterSize);
 	WriteItem(SaveFileGifSampleFactor);
+	WriteItem(SaveFileGifPaletteMode);
 
 	WriteItem(SaveFileWebpDurOverride);
 	WriteItem(SaveFileGifDurOverride);
@@ -836,6 +844,8 @@ bool Config::ProfileData::Save(tExprWriter& writer) const
 	WriteItem(StrictLoading);
 	WriteItem(MetaDataOrientLoading);
 	WriteItem(DetectAPNGInsidePNG);
+	WriteItem(DeltaFrameStorage);
+	WriteItem(KeepTexturesCompressed);
 	WriteItem(MipmapFilter);
 	WriteItem(MipmapChaining);
 	WriteItem(AutoPropertyWindow);
@@ -243,6 +243,7 @@ struct ProfileData
 	float	SaveFileGifDitherLevel;							// E [0.0f, inf]
 	int		SaveFileGifFilterSize;							// E [0, 2] Maps to 1, 3, 5.
 	int		SaveFileGifSampleFactor;						// E [1, 10]
+	int		SaveFileGifPaletteMode;							// E [0, 2]. See GifPalette::Mode. 0 = Per-frame. 1 = Global. 2 = Adaptive.
 
 	int		SaveFileWebpDurOverride;						// E [-1, inf]. In ms.
 	int		SaveFileGifDurOverride;							// E [-1, inf]. In 1/100 seconds.
@@ -301,12 +302,14 @@ struct ProfileData
 	float GetResizeAspectRatioFloat() const					{ tImage::tAspectRatio aspect = GetResizeAspectRatio(); return (aspect == tImage::tAspectRatio::User) ? float(ResizeAspectUserNum) / float(ResizeAspectUserDen) : tImage::tGetAspectRatioFloat(aspect); }
 	int ResizeAspectMode;									// 0 = Crop Mode. 1 = Letterbox Mode.
 
-	int MaxImageMemMB;										// Max image mem before unloading images.
+	int MaxImageMemMB;										// Max image mem before unloading images. Bigger animations are not loaded.
 	int MaxCacheFiles;										// Max number of cache files before removing oldest.
 	int MaxUndoSteps;
 	bool StrictLoading;										// No attempt to display ill-formed images.
 	bool MetaDataOrientLoading;								// Reorient images on load if Exif or other meta-data contains orientation information.
 	bool DetectAPNGInsidePNG;								// Look for APNG data (animated) hidden inside a regular PNG file.
+	bool DeltaFrameStorage;									// Keep animated frames in memory as dirty-rect deltas when it saves memory.
+	bool KeepTexturesCompressed;							// Keep block-compressed dds/ktx/pvr/astc data compressed in memory and decode on demand.
 	int MipmapFilter;										// Matches tImage::tResampleFilter. Use None for no mipmaps.
 	bool MipmapChaining;									// True for faster mipmap generation. False for a lot slower and slightly better results.
 	bool AutoPropertyWindow;								// Auto display property editor window for supported file types.
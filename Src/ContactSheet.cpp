@@ -19,6 +19,8 @@
 #include "TacentView.h"
 #include "GuiUtil.h"
 #include "Image.h"
+#include "Resampler.h"
+#include "Task.h"
 namespace Viewer { extern void DoFillColourInterface(const char* = nullptr, bool = false); }
 using namespace tStd;
 using namespace tMath;
@@ -328,90 +330,115 @@ void Viewer::SaveContactSheetTo
 	int finalWidth, int finalHeight
 )
 {
-	Config::ProfileData& profile = Config::GetProfileData();
-
-	tImage::tPicture outPic(contactWidth, contactHeight);
-	outPic.SetAll(profile.FillColourContact);
-
-	// Do the work.
-	int frameWidth = contactWidth / numCols;
-	int frameHeight = contactHeight / numRows;
-	int ix = 0;
-	int iy = 0;
-	int frame = 0;
-
-	tPrintf("Loading all frames...\n");
+	// Loading every image is the slow part so it all happens in a task. Images that are already loaded have their
+	// current picture copied now and the rest are loaded privately by the task.
+	std::vector<Task::ImageSnapshot*>* snapshots = new std::vector<Task::ImageSnapshot*>;
 	for (Image* img = Images.First(); img; img = img->Next())
-	{
-		if (!img->IsLoaded())
-			img->Load();
-	}
+		snapshots->push_back(new Task::ImageSnapshot(*img));
+	bool* saved = new bool(false);
 
-	Image* currImg = Images.First();
-	while (currImg)
-	{
-		if (!currImg->IsLoaded())
+	bool started = Task::Start
+	(
+		"Generating Contact Sheet",
+		[=](Task::Context& context)
 		{
-			currImg = currImg->Next();
-			continue;
-		}
-
-		tPrintf("Processing frame %d : %s at (%d, %d).\n", frame, currImg->Filename.Chr(), ix, iy);
-		frame++;
-		tImage::tPicture* currPic = currImg->GetCurrentPic();
+			Config::ProfileData& profile = Config::GetProfileData();
+			tImage::tPicture outPic(contactWidth, contactHeight);
+			outPic.SetAll(profile.FillColourContact);
+
+			// Do the work.
+			int frameWidth = contactWidth / numCols;
+			int frameHeight = contactHeight / numRows;
+			int numFrames = numCols * numRows;
+			int ix = 0;
+			int iy = 0;
+			int frame = 0;
+			for (Task::ImageSnapshot*& snapshot : *snapshots)
+			{
+				if (context.IsCancelled())
+					return;
+
+				tImage::tPicture* currPic = snapshot->GetPicture();
+				if (!currPic)
+				{
+					delete snapshot;
+					snapshot = nullptr;
+					continue;
+				}
+
+				tPrintf("Processing frame %d : %s at (%d, %d).\n", frame, snapshot->Filename.Chr(), ix, iy);
+				frame++;
+
+				// The picture belongs to the snapshot so it is resampled in place rather than copied.
+				if ((currPic->GetWidth() != frameWidth) || (currPic->GetHeight() != frameHeight))
+				{
+					Resampler::Resample(*currPic, frameWidth, frameHeight, tImage::tResampleFilter(profile.ResampleFilterContactFrame), tImage::tResampleEdgeMode(profile.ResampleEdgeModeContactFrame));
+				}
+				else
+				{
+					tPrintf("No resizing of [%s] needed.\n", tSystem::tGetFileBaseName(snapshot->Filename).Chr());
+				}
+
+				// Copy resampled frame into place.
+				for (int y = 0; y < frameHeight; y++)
+					for (int x = 0; x < frameWidth; x++)
+						outPic.SetPixel
+						(
+							x + (ix*frameWidth),
+							y + ((numRows-1-iy)*frameHeight),
+							currPic->GetPixel(x, y)
+						);
+
+				// Free as we go so at most one loaded picture is held by the task.
+				delete snapshot;
+				snapshot = nullptr;
+				context.SetProgress(float(frame) / float(numFrames));
+
+				ix++;
+				if (ix >= numCols)
+				{
+					ix = 0;
+					iy++;
+					if (iy >= numRows)
+						break;
+				}
+			}
 
-		tImage::tPicture resampled;
-		if ((currImg->GetWidth() != frameWidth) || (currImg->GetHeight() != frameHeight))
-		{
-			resampled.Set(*currPic);
-			resampled.Resample(frameWidth, frameHeight, tImage::tResampleFilter(profile.ResampleFilterContactFrame), tImage::tResampleEdgeMode(profile.ResampleEdgeModeContactFrame));
-		}
-		else
+			tFileType saveFileType = tGetFileTypeFromName(profile.SaveFileType);
+			if ((finalWidth == contactWidth) && (finalHeight == contactHeight))
+			{
+				tPrintf("No resizing of output [%s] image needed.\n", tSystem::tGetFileBaseName(outFile).Chr());
+				*saved = SavePictureAs(outPic, outFile, saveFileType, true);
+			}
+			else
+			{
+				Resampler::Resample(outPic, finalWidth, finalHeight, tImage::tResampleFilter(profile.ResampleFilterContactFinal), tImage::tResampleEdgeMode(profile.ResampleEdgeModeContactFinal));
+				*saved = SavePictureAs(outPic, outFile, saveFileType, true);
+			}
+		},
+		[=](bool cancelled)
 		{
-			tPrintf("No resizing of [%s] needed.\n", tSystem::tGetFileBaseName(currImg->Filename).Chr());
-		}
-
-		// Copy resampled frame into place.
-		for (int y = 0; y < frameHeight; y++)
-			for (int x = 0; x < frameWidth; x++)
-				outPic.SetPixel
-				(
-					x + (ix*frameWidth),
-					y + ((numRows-1-iy)*frameHeight),
-					resampled.IsValid() ? resampled.GetPixel(x, y) : currPic->GetPixel(x, y)
-				);
-
-		currImg = currImg->Next();
+			// If we saved to the same dir we are currently viewing, reload
+			// and set the current image to the generated one.
+			if (*saved && ImagesDir.IsEqualCI( tGetDir(outFile) ))
+			{
+				Images.Clear();
+				PopulateImages();
+				SetCurrentImage(outFile);
+			}
 
-		ix++;
-		if (ix >= numCols)
-		{
-			ix = 0;
-			iy++;
-			if (iy >= numRows)
-				break;
+			for (Task::ImageSnapshot* snapshot : *snapshots)
+				delete snapshot;
+			delete snapshots;
+			delete saved;
 		}
-	}
-
-	tFileType saveFileType = tGetFileTypeFromName(profile.SaveFileType);
-	if ((finalWidth == contactWidth) && (finalHeight == contactHeight))
-	{
-		tPrintf("No resizing of output [%s] image needed.\n", tSystem::tGetFileBaseName(outFile).Chr());
-		SavePictureAs(outPic, outFile, saveFileType, true);
-	}
-	else
-	{
-		tImage::tPicture finalResampled(outPic);
-		finalResampled.Resample(finalWidth, finalHeight, tImage::tResampleFilter(profile.ResampleFilterContactFinal), tImage::tResampleEdgeMode(profile.ResampleEdgeModeContactFinal));
-		SavePictureAs(finalResampled, outFile, saveFileType, true);
-	}
+	);
 
-	// If we saved to the same dir we are currently viewing, reload
-	// and set the current image to the generated one.
-	if (ImagesDir.IsEqualCI( tGetDir(outFile) ))
+	if (!started)
 	{
-		Images.Clear();
-		PopulateImages();
-		SetCurrentImage(outFile);
+		for (Task::ImageSnapshot* snapshot : *snapshots)
+			delete snapshot;
+		delete snapshots;
+		delete saved;
 	}
 }
@@ -0,0 +1,212 @@
+// GifPalette.cpp
+//
+// Palette sharing for multi-frame GIF export. The GIF encoder normally builds a palette for every frame on its own.
+// For long, mostly static animations like screen captures that repeats the same expensive palette build hundreds of
+// times. The modes here build fewer palettes and map the frames to them before the encoder sees them.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <vector>
+#include <Foundation/tFundamentals.h>
+#include <Image/tQuantizeFixed.h>
+#include <Image/tQuantizeSpatial.h>
+#include <Image/tQuantizeNeu.h>
+#include <Image/tQuantizeWu.h>
+#include "GifPalette.h"
+#include "PaletteMap.h"
+#include "Parallel.h"
+using namespace tMath;
+using namespace tImage;
+
+
+namespace GifPalette
+{
+	const char* ModeNames[int(Mode::NumModes)] = { "Per Frame", "Global", "Adaptive" };
+
+	// Palettes are built from at most this many pixels. For the global palette the budget is shared by all frames.
+	const int SampleMaxPixels = 512*512;
+
+	// Histograms have 4 bits per channel. Values are fractions of the frame so frames of any size compare.
+	const int HistogramBits = 4;
+	const int HistogramSize = 1 << (3*HistogramBits);
+
+	// The L1 distance between two normalized histograms is twice the fraction of pixels that moved to a different bin.
+	// Below this the frame keeps the previous palette.
+	const float AdaptiveMaxHistogramDist = 0.1f;
+
+	int GetStride(int width, int height, int maxPixels);
+	void SamplePixels(tPixel3b* dest, const tFrame&, int stride);
+	void BuildPalette(tColour3b* palette, int numColours, const tPixel3b* pixels, int width, int height, const tImageGIF::SaveParams&);
+	void ComputeHistogram(std::vector<float>& histogram, const tFrame&);
+	float HistogramDist(const std::vector<float>& a, const std::vector<float>& b);
+}
+
+
+int GifPalette::GetStride(int width, int height, int maxPixels)
+{
+	int stride = 1;
+	while (((width + stride - 1)/stride) * ((height + stride - 1)/stride) > maxPixels)
+		stride++;
+	return stride;
+}
+
+
+void GifPalette::SamplePixels(tPixel3b* dest, const tFrame& frame, int stride)
+{
+	for (int y = 0; y < frame.Height; y += stride)
+	{
+		const tPixel4b* row = frame.Pixels + y*frame.Width;
+		for (int x = 0; x < frame.Width; x += stride)
+			*dest++ = tPixel3b(row[x].R, row[x].G, row[x].B);
+	}
+}
+
+
+void GifPalette::BuildPalette(tColour3b* palette, int numColours, const tPixel3b* pixels, int width, int height, const tImageGIF::SaveParams& params)
+{
+	// The indices are not needed. Only the palette is kept. An exact palette is used if there are few enough colours.
+	std::vector<uint8> indices(width*height);
+	switch (params.Method)
+	{
+		case tQuantize::Method::Fixed:
+			tQuantizeFixed::QuantizeImage(numColours, width, height, pixels, palette, indices.data(), true);
+			break;
+
+		case tQuantize::Method::Spatial:
+			tQuantizeSpatial::QuantizeImage(numColours, width, height, pixels, palette, indices.data(), true, params.DitherLevel, params.FilterSize);
+			break;
+
+		case tQuantize::Method::Neu:
+			tQuantizeNeu::QuantizeImage(numColours, width, height, pixels, palette, indices.data(), true, params.SampleFactor);
+			break;
+
+		case tQuantize::Method::Wu:
+		default:
+			tQuantizeWu::QuantizeImage(numColours, width, height, pixels, palette, indices.data(), true);
+			break;
+	}
+}
+
+
+void GifPalette::ComputeHistogram(std::vector<float>& histogram, const tFrame& frame)
+{
+	histogram.assign(HistogramSize, 0.0f);
+	const int shift = 8 - HistogramBits;
+	int stride = GetStride(frame.Width, frame.Height, SampleMaxPixels);
+	int count = 0;
+	for (int y = 0; y < frame.Height; y += stride)
+	{
+		const tPixel4b* row = frame.Pixels + y*frame.Width;
+		for (int x = 0; x < frame.Width; x += stride, count++)
+			histogram[((row[x].R >> shift) << (2*HistogramBits)) | ((row[x].G >> shift) << HistogramBits) | (row[x].B >> shift)] += 1.0f;
+	}
+
+	float scale = 1.0f / float(tMax(count, 1));
+	for (float& bin : histogram)
+		bin *= scale;
+}
+
+
+float GifPalette::HistogramDist(const std::vector<float>& a, const std::vector<float>& b)
+{
+	float dist = 0.0f;
+	for (int h = 0; h < HistogramSize; h++)
+		dist += tAbs(a[h] - b[h]);
+	return dist;
+}
+
+
+bool GifPalette::Apply(tList<tFrame>& frames, Mode mode, const tImageGIF::SaveParams& params)
+{
+	if ((mode == Mode::PerFrame) || (frames.GetNumItems() < 2))
+		return false;
+
+	std::vector<tFrame*> frameTable;
+	for (tFrame* frame = frames.First(); frame; frame = frame->Next())
+	{
+		if (!frame->IsValid() || (frame->Width != frames.First()->Width) || (frame->Height != frames.First()->Height))
+			return false;
+		frameTable.push_back(frame);
+	}
+	int numFrames = int(frameTable.size());
+	int width = frameTable[0]->Width;
+	int height = frameTable[0]->Height;
+	int area = width*height;
+
+	// Work out how many colours the encoder will use. Transparency takes one, and in auto mode the encoder only uses
+	// it if some pixel is not opaque.
+	int bpp = int(params.Format) - int(tPixelFormat::PAL1BIT) + 1;
+	tiClamp(bpp, 1, 8);
+	bool transparent = false;
+	if ((bpp > 1) && (params.AlphaThreshold < 255))
+	{
+		transparent = (params.AlphaThreshold >= 0);
+		for (int f = 0; (f < numFrames) && !transparent; f++)
+			for (int p = 0; (p < area) && !transparent; p++)
+				transparent = (frameTable[f]->Pixels[p].A < 255);
+	}
+	int numColours = (1 << bpp) - (transparent ? 1 : 0);
+
+	// Which palette each frame maps to.
+	std::vector<int> framePalette(numFrames, 0);
+	std::vector<tColour3b> palettes;
+
+	if (mode == Mode::Global)
+	{
+		// Every frame contributes an equal, evenly strided share of the sample. The sampling is spread across threads
+		// and the sample is stacked vertically so the quantizer sees one image.
+		int stride = GetStride(width, height, tMax(SampleMaxPixels / numFrames, 1));
+		int sampleW = (width + stride - 1) / stride;
+		int sampleH = (height + stride - 1) / stride;
+		std::vector<tPixel3b> sample(sampleW*sampleH*numFrames);
+		Parallel::For(numFrames, [&](int f) { SamplePixels(&sample[f*sampleW*sampleH], *frameTable[f], stride); });
+
+		palettes.resize(numColours);
+		BuildPalette(palettes.data(), numColours, sample.data(), sampleW, sampleH*numFrames, params);
+	}
+	else
+	{
+		// Histograms are independent so they are computed in parallel. Choosing which frames get a new palette is
+		// sequential. A frame is compared with the frame its palette was built from, not the previous frame, so slow
+		// drift still triggers a rebuild.
+		std::vector<std::vector<float>> histograms(numFrames);
+		Parallel::For(numFrames, [&](int f) { ComputeHistogram(histograms[f], *frameTable[f]); });
+
+		int stride = GetStride(width, height, SampleMaxPixels);
+		int sampleW = (width + stride - 1) / stride;
+		int sampleH = (height + stride - 1) / stride;
+		std::vector<tPixel3b> sample(sampleW*sampleH);
+		int reference = -1;
+		int numPalettes = 0;
+		for (int f = 0; f < numFrames; f++)
+		{
+			if ((reference < 0) || (HistogramDist(histograms[f], histograms[reference]) > AdaptiveMaxHistogramDist))
+			{
+				reference = f;
+				numPalettes++;
+				palettes.resize(numPalettes*numColours);
+				SamplePixels(sample.data(), *frameTable[f], stride);
+				BuildPalette(&palettes[(numPalettes-1)*numColours], numColours, sample.data(), sampleW, sampleH, params);
+			}
+			framePalette[f] = numPalettes-1;
+		}
+	}
+
+	// Each PaletteMap is built once and shared by the frames that use it. The frames are mapped in parallel.
+	int numPalettes = int(palettes.size()) / numColours;
+	std::vector<Viewer::PaletteMap*> paletteMaps(numPalettes);
+	Parallel::For(numPalettes, [&](int p) { paletteMaps[p] = new Viewer::PaletteMap(&palettes[p*numColours], numColours); });
+	Parallel::For(numFrames, [&](int f) { paletteMaps[framePalette[f]]->MapPixels(frameTable[f]->Pixels, area); });
+
+	for (Viewer::PaletteMap* paletteMap : paletteMaps)
+		delete paletteMap;
+	return true;
+}
@@ -0,0 +1,40 @@
+// GifPalette.h
+//
+// Palette sharing for multi-frame GIF export. The GIF encoder normally builds a palette for every frame on its own.
+// For long, mostly static animations like screen captures that repeats the same expensive palette build hundreds of
+// times. The modes here build fewer palettes and map the frames to them before the encoder sees them.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tList.h>
+#include <Image/tFrame.h>
+#include <Image/tImageGIF.h>
+
+
+namespace GifPalette
+{
+	enum class Mode
+	{
+		PerFrame,			// The encoder builds a palette for every frame. Nothing is done here.
+		Global,				// One palette is built from a sampled subset of all frames and used for every frame.
+		Adaptive,			// A frame reuses the last palette unless its colour histogram has changed noticeably.
+		NumModes
+	};
+	extern const char* ModeNames[int(Mode::NumModes)];
+
+	// Maps the RGB of every frame (in place) to palettes built with the quantize method in params. Afterwards no frame
+	// has more colours than the encoder will use, so it keeps them exactly instead of quantizing again. The number of
+	// colours comes from the params format, one fewer if the GIF will have transparency. Does nothing for PerFrame,
+	// for a single frame, or if the frames are not all the same size. Returns true if the frames were modified. The
+	// palettes come from the library quantizers, so the caller must hold the quantize lock (Viewer::GetQuantizeMutex).
+	bool Apply(tList<tImage::tFrame>& frames, Mode, const tImage::tImageGIF::SaveParams&);
+}
@@ -12,7 +12,9 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <algorithm>
 #include <mutex>
+#include <type_traits>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>				// Include glfw3.h after our OpenGL definitions.
 #include <Foundation/tHash.h>
@@ -22,7 +24,14 @@
 #include <System/tMachine.h>
 #include <System/tChunk.h>
 #include <Math/tRandom.h>
+#include <Image/tPixelUtil.h>
 #include "Image.h"
+#include "MetaTable.h"
+#include "PaletteMap.h"
+#include "Parallel.h"
+#include "Probe.h"
+#include "Quantize.h"
+#include "Resampler.h"
 #include "Config.h"
 using namespace tStd;
 using namespace tSystem;
@@ -31,6 +40,9 @@ using namespace tMath;
 using namespace Viewer;
 int Image::ThumbnailNumThreadsRunning = 0;
 tString Image::ThumbCacheDir;
+int64 Image::LayerCacheTotalBytes = 0;
+uint64 Image::LayerCacheUseCount = 0;
+std::vector<Image*> Image::LayerCacheImages;
 static tMath::tRandom::tGeneratorMersenneTwister ShuffleGenerator((uint64)tSystem::tGetTimeUTC());
 
 
@@ -96,6 +108,7 @@ Image::~Image()
 
 	// Free GPU image mem and texture IDs.
 	Unload(true);
+	ClearLayerCache();
 }
 
 
@@ -181,10 +194,16 @@ bool Image::Load(bool loadParamsFromConfig)
 	if ((Filetype == tSystem::tFileType::PNG) && detectAPNGInsidePNG && tImageAPNG::IsAnimatedPNG(Filename))
 		loadingFiletype = tSystem::tFileType::APNG;
 
+	// The animation loaders decode every frame before returning, so a long high resolution clip could need far more
+	// memory than the machine has. Those whose decoded size is over the image memory budget are refused up front.
+	if (loadParamsFromConfig && !CheckAnimationFitsBudget(loadingFiletype))
+		return false;
+
 	Info.SrcPixelFormat		= tPixelFormat::Invalid;
 	Info.SrcColourProfile	= tColourProfile::Unspecified;
 	Info.AlphaMode			= tAlphaMode::Unspecified;
 	Info.ChannelType		= tChannelType::Unspecified;
+	bool keepCompressed		= CompactStorageEnabled && profile.KeepTexturesCompressed;
 	bool success = false;
 
 	switch (loadingFiletype)
@@ -278,7 +297,7 @@ bool Image::Load(bool loadParamsFromConfig)
 		case tSystem::tFileType::HDR:
 		{
 			tImageHDR hdr;
-			bool ok = hdr.Load(Filename, LoadParams_HDR);
+			bool ok = LoadImageType(hdr, LoadParams_HDR);
 			if (!ok)
 				break;
 
@@ -348,6 +367,7 @@ bool Image::Load(bool loadParamsFromConfig)
 			Pictures.Append(picture);
 
 			Cached_MetaData = jpg.MetaData;
+			ImagesMetaTable.SetRow(MetaRow, Cached_MetaData);
 			success = true;
 			break;
 		}
@@ -476,8 +496,16 @@ bool Image::Load(bool loadParamsFromConfig)
 					params.Flags &= ~tImageDDS::LoadFlag_StrictLoading;
 			}
 
+			// Keeping the data compressed is tried first. It falls back to a regular decoding load if the pixel format or
+			// the load parameters need the loader to do the decode.
+			if (keepCompressed && LoadCompressedResident<tImageDDS>(params))
+			{
+				success = true;
+				break;
+			}
+
 			tImageDDS dds;
-			bool ok = dds.Load(Filename, params);
+			bool ok = LoadImageType(dds, params);
 			if (!ok || !dds.IsValid())
 				break;
 
@@ -508,8 +536,15 @@ bool Image::Load(bool loadParamsFromConfig)
 					params.Flags &= ~tImagePVR::LoadFlag_MetaDataOrient;
 			}
 
+			// The meta-data orientation is only applied when decoding.
+			if (keepCompressed && !(params.Flags & tImagePVR::LoadFlag_MetaDataOrient) && LoadCompressedResident<tImagePVR>(params))
+			{
+				success = true;
+				break;
+			}
+
 			tImagePVR pvr;
-			bool ok = pvr.Load(Filename, params);
+			bool ok = LoadImageType(pvr, params);
 			if (!ok || !pvr.IsValid())
 				break;
 
@@ -527,8 +562,14 @@ bool Image::Load(bool loadParamsFromConfig)
 		case tSystem::tFileType::KTX:
 		case tSystem::tFileType::KTX2:
 		{
+			if (keepCompressed && LoadCompressedResident<tImageKTX>(LoadParams_KTX))
+			{
+				success = true;
+				break;
+			}
+
 			tImageKTX ktx;
-			bool ok = ktx.Load(Filename, LoadParams_KTX);
+			bool ok = LoadImageType(ktx, LoadParams_KTX);
 			if (!ok || !ktx.IsValid())
 				break;
 
@@ -545,8 +586,14 @@ bool Image::Load(bool loadParamsFromConfig)
 
 		case tSystem::tFileType::ASTC:
 		{
+			if (keepCompressed && LoadCompressedResident<tImageASTC>(LoadParams_ASTC))
+			{
+				success = true;
+				break;
+			}
+
 			tImageASTC astc;
-			bool ok = astc.Load(Filename, LoadParams_ASTC);
+			bool ok = LoadImageType(astc, LoadParams_ASTC);
 			if (!ok)
 				break;
 
@@ -572,7 +619,7 @@ bool Image::Load(bool loadParamsFromConfig)
 		case tSystem::tFileType::PKM:
 		{
 			tImagePKM pkm;
-			bool ok = pkm.Load(Filename, LoadParams_PKM);
+			bool ok = LoadImageType(pkm, LoadParams_PKM);
 			if (!ok)
 				break;
 
@@ -596,13 +643,249 @@ bool Image::Load(bool loadParamsFromConfig)
 		}
 	}
 
+	RebuildFrameTable();
 	if (!success)
 		return false;
 
 	LoadedTime = tSystem::tGetTime();
+	UpdateOpacityInfo();
+
+	if (CompactStorageEnabled && profile.DeltaFrameStorage)
+		CompactDeltaFrames();
+
+	Info.FileSizeBytes		= tSystem::tGetFileSize(Filename);
+	Info.MemSizeBytes		= GetMemSizeBytes();
+	ClearDirty();
+	return true;
+}
+
+
+bool Image::CheckAnimationFitsBudget(tSystem::tFileType loadingFiletype) const
+{
+	if ((loadingFiletype != tFileType::GIF) && (loadingFiletype != tFileType::WEBP) && (loadingFiletype != tFileType::APNG))
+		return true;
+
+	Probe::Result probe;
+	if (!Probe::ProbeFile(probe, Filename, loadingFiletype, false))
+		return true;
+
+	// Counting stops as soon as the budget is known to be exceeded. A single frame is always allowed.
+	Config::ProfileData& profile = Config::GetProfileData();
+	int64 budgetBytes = int64(profile.MaxImageMemMB) * 1024 * 1024;
+	int64 frameBytes = int64(probe.Width) * int64(probe.Height) * int64(sizeof(tPixel4b));
+	int maxFrames = int(tClamp(budgetBytes/frameBytes + 1, int64(2), int64(0x7FFFFFFF)));
+	int numFrames = Probe::CountFrames(Filename, loadingFiletype, maxFrames);
+	if ((numFrames <= 1) || (int64(numFrames)*frameBytes <= budgetBytes))
+		return true;
+
+	tPrintf
+	(
+		"Warning: Not loading %s. %dx%d with at least %d frames needs over %d MB decoded. Max Mem is %d MB.\n",
+		tGetFileName(Filename).Chr(), probe.Width, probe.Height, numFrames,
+		int((int64(numFrames)*frameBytes) / (1024*1024)), profile.MaxImageMemMB
+	);
+	return false;
+}
+
+
+template<typename ImageType> bool Image::LoadImageType(ImageType& img, const typename ImageType::LoadParams& params)
+{
+	if (FileData)
+		return img.Load(FileData, FileDataSize, params);
+
+	return img.Load(Filename, params);
+}
+
+
+bool Image::FetchFileData()
+{
+	switch (Filetype)
+	{
+		case tFileType::DDS:
+		case tFileType::PVR:
+		case tFileType::KTX:
+		case tFileType::KTX2:
+		case tFileType::ASTC:
+		case tFileType::PKM:
+		case tFileType::HDR:
+			break;
+
+		default:
+			return false;
+	}
+
+	// The kept contents are only good while the file on disk is unchanged.
+	tSystem::tFileInfo info;
+	if (!tSystem::tGetFileInfo(info, Filename))
+	{
+		ReleaseFileData();
+		return false;
+	}
+
+	if (FileData && (FileDataModTime == info.ModificationTime) && (uint64(FileDataSize) == info.FileSize))
+		return true;
+
+	ReleaseFileData();
+	FileData = tSystem::tLoadFile(Filename, nullptr, &FileDataSize);
+	FileDataModTime = info.ModificationTime;
+	return (FileData != nullptr);
+}
+
+
+void Image::ReleaseFileData()
+{
+	delete[] FileData;
+	FileData = nullptr;
+	FileDataSize = 0;
+}
+
+
+Image* Image::CreateLoadCopy() const
+{
+	Image* copy = new Image(Filename);
+	copy->LoadParams_ASTC					= LoadParams_ASTC;
+	copy->LoadParams_DDS					= LoadParams_DDS;
+	copy->LoadParams_PVR					= LoadParams_PVR;
+	copy->LoadParams_EXR					= LoadParams_EXR;
+	copy->LoadParams_HDR					= LoadParams_HDR;
+	copy->LoadParams_JPG					= LoadParams_JPG;
+	copy->LoadParams_KTX					= LoadParams_KTX;
+	copy->LoadParams_PKM					= LoadParams_PKM;
+	copy->LoadParams_PNG					= LoadParams_PNG;
+	copy->LoadParams_DetectAPNGInsidePNG	= LoadParams_DetectAPNGInsidePNG;
+	copy->CompactStorageEnabled				= CompactStorageEnabled;
+	return copy;
+}
+
+
+void Image::Reload()
+{
+	if (Dirty)
+		return;
+
+	if (!IsLoaded())
+	{
+		Load();
+		return;
+	}
+
+	// Only one worker at a time. The latest parameters are picked up when it finishes.
+	if (ReloadThread.joinable())
+	{
+		ReloadPending = true;
+		return;
+	}
+
+	FetchFileData();
+	ReloadResult = CreateLoadCopy();
+
+	// The worker borrows our file contents. They are not released while the thread is running.
+	ReloadResult->FileData							= FileData;
+	ReloadResult->FileDataSize						= FileDataSize;
+
+	ReloadDone = false;
+	Image* result = ReloadResult;
+	ReloadThread = std::thread
+	(
+		[this, result]()
+		{
+			result->Load();
+			result->FileData = nullptr;
+			result->FileDataSize = 0;
+			ReloadDone = true;
+		}
+	);
+}
+
+
+void Image::UpdateReload()
+{
+	if (!ReloadThread.joinable() || !ReloadDone)
+		return;
+
+	ReloadThread.join();
+	Image* result = ReloadResult;
+	ReloadResult = nullptr;
+
+	// If the image was edited while the worker was busy the edits win. A failed decode leaves the previous pictures.
+	if (!Dirty && result->IsLoaded())
+		TakeLoaded(*result);
+	delete result;
+
+	if (ReloadPending)
+	{
+		ReloadPending = false;
+		Reload();
+	}
+}
+
+
+void Image::CancelReload()
+{
+	// The decode can't be interrupted so this waits for it.
+	if (ReloadThread.joinable())
+		ReloadThread.join();
+
+	delete ReloadResult;
+	ReloadResult = nullptr;
+	ReloadPending = false;
+}
+
+
+void Image::TakeLoaded(Image& src)
+{
+	bool altEnabled = AltPictureEnabled;
+	FreeLoaded();
+
+	while (tPicture* picture = src.Pictures.Remove())
+		Pictures.Append(picture);
+	DeltaFrames.swap(src.DeltaFrames);
+	DeltaScratchFrame = src.DeltaScratchFrame;
+	CompressedFrames.swap(src.CompressedFrames);
+	AltPictureTyp = src.AltPictureTyp;
+	Info = src.Info;
+	LoadedTime = src.LoadedTime;
+	RebuildFrameTable();
+
+	FrameNum = tClamp(FrameNum, 0, tClampMin(GetNumFrames()-1, 0));
+	if (altEnabled && (AltPictureTyp != AltPictureType::None))
+		EnableAltPicture(true);
+}
+
+
+void Image::Set(tList<tFrame>& frames)
+{
+	Unload(true);
+	while (tFrame* frame = frames.Remove())
+		Pictures.Append(new tPicture(frame, true));
+	RebuildFrameTable();
+	if (!IsLoaded())
+		return;
+
+	LoadedTime = tSystem::tGetTime();
+	Info.SrcPixelFormat		= tPixelFormat::R8G8B8A8;
+	Info.SrcColourProfile	= tColourProfile::sRGB;
+	Info.AlphaMode			= tAlphaMode::Unspecified;
+	Info.ChannelType		= tChannelType::Unspecified;
+	UpdateOpacityInfo();
+	Info.FileSizeBytes		= 0;
+	Info.MemSizeBytes		= GetMemSizeBytes();
+	Dirty = true;
+}
 
-	// Fill in rest of info struct.
+
+void Image::UpdateOpacityInfo()
+{
+	// Compressed-resident images only decode what is displayed, so only the first picture is checked for those.
 	bool foundOpaque = false; bool foundTransparent = false;
+	if (!CompressedFrames.empty())
+	{
+		tPicture* pic = GetPic(0);
+		if (pic && pic->IsOpaque())
+			foundOpaque = true;
+		else
+			foundTransparent = true;
+	}
 	for (tPicture* pic = Pictures.First(); pic; pic = pic->Next())
 	{
 		if (pic->IsOpaque())
@@ -615,11 +898,6 @@ bool Image::Load(bool loadParamsFromConfig)
 		Info.Opacity = ImgInfo::OpacityEnum::True;
 	else if (foundTransparent && !foundOpaque)
 		Info.Opacity = ImgInfo::OpacityEnum::False;
-
-	Info.FileSizeBytes		= tSystem::tGetFileSize(Filename);
-	Info.MemSizeBytes		= GetMemSizeBytes();
-	ClearDirty();
-	return true;
 }
 
 
@@ -634,7 +912,9 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			tPicture* picture = GetCurrentPic();
 			if (!picture || !picture->IsValid())
 				return false;
-			tImageTGA tga(*picture, false);
+			// The TGA, JPG, QOI, and BMP savers only read the pixels, so they borrow the picture's rather than copying
+			// them. StealPixels hands them back after the save so the save object never frees them.
+			tImageTGA tga(picture->GetPixelPointer(), picture->GetWidth(), picture->GetHeight(), true);
 			tImageTGA::SaveParams params(SaveParamsTGA);
 			if (useConfigSaveParams)
 			{
@@ -649,6 +929,7 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			}
 
 			tImageTGA::tFormat savedFmt = tga.Save(outFile, params);
+			tga.StealPixels();
 			success = (savedFmt != tImageTGA::tFormat::Invalid);
 			break;
 		}
@@ -659,6 +940,8 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			if (!picture || !picture->IsValid())
 				return false;
 
+			// PNG takes its own copy. The 16 bit-per-component formats have the saver convert its pixel buffer, so
+			// it can't safely borrow the picture's.
 			tImagePNG png(*picture, false);
 			tImagePNG::SaveParams params(SaveParamsPNG);
 			if (useConfigSaveParams)
@@ -683,12 +966,13 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			if (!picture || !picture->IsValid())
 				return false;
 
-			tImageJPG jpg(*picture, false);
+			tImageJPG jpg(picture->GetPixelPointer(), picture->GetWidth(), picture->GetHeight(), true);
 			tImageJPG::SaveParams params(SaveParamsJPG);
 			if (useConfigSaveParams)
 				params.Quality = profile.SaveFileJpegQuality;
 
 			success = jpg.Save(outFile, params);
+			jpg.StealPixels();
 			break;
 		}
 
@@ -711,9 +995,10 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			}
 			else
 			{
-				const tList<tImage::tPicture>& pics = GetPictures();
-				for (const tPicture* picture = pics.First(); picture; picture = picture->Next())
+				int numFrames = GetNumFrames();
+				for (int frame = 0; frame < numFrames; frame++)
 				{
+					const tPicture* picture = GetPic(frame);
 					frames.Append
 					(
 						new tFrame
@@ -727,8 +1012,8 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 				}
 			}
 
-			tImageGIF gif(frames, true);
 			tImageGIF::SaveParams params(SaveParamsGIF);
+			GifPalette::Mode paletteMode = SaveParamsGIFPalette;
 			if (useConfigSaveParams)
 			{
 				params.Format					= tPixelFormat(int(tPixelFormat::FirstPalette) + profile.SaveFileGifBPP - 1);
@@ -739,7 +1024,13 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 				params.DitherLevel				= double(profile.SaveFileGifDitherLevel);
 				params.FilterSize				= (profile.SaveFileGifFilterSize * 2) + 1;
 				params.SampleFactor				= profile.SaveFileGifSampleFactor;
+				paletteMode						= GifPalette::Mode(profile.SaveFileGifPaletteMode);
 			}
+
+			// The frames are copies so they may be mapped to shared palettes in place. The save quantizes too.
+			const std::lock_guard<std::mutex> lock(GetQuantizeMutex());
+			GifPalette::Apply(frames, paletteMode, params);
+			tImageGIF gif(frames, true);
 			success = gif.Save(outFile, params);
 			break;
 		}
@@ -763,9 +1054,10 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			}
 			else
 			{
-				const tList<tImage::tPicture>& pics = GetPictures();
-				for (tPicture* picture = pics.First(); picture; picture = picture->Next())
+				int numFrames = GetNumFrames();
+				for (int frame = 0; frame < numFrames; frame++)
 				{
+					const tPicture* picture = GetPic(frame);
 					frames.Append
 					(
 						new tFrame
@@ -797,7 +1089,7 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			if (!picture || !picture->IsValid())
 				return false;
 
-			tImageQOI qoi(*picture, false);
+			tImageQOI qoi(picture->GetPixelPointer(), picture->GetWidth(), picture->GetHeight(), true);
 			tImageQOI::SaveParams params(SaveParamsQOI);
 			if (useConfigSaveParams)
 			{
@@ -817,6 +1109,7 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			}
 
 			tImageQOI::tFormat savedFormat = qoi.Save(outFile, params);
+			qoi.StealPixels();
 			success = (savedFormat != tImageQOI::tFormat::Invalid);
 			break;
 		}
@@ -840,9 +1133,10 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			}
 			else
 			{
-				const tList<tImage::tPicture>& pics = GetPictures();
-				for (tPicture* picture = pics.First(); picture; picture = picture->Next())
+				int numFrames = GetNumFrames();
+				for (int frame = 0; frame < numFrames; frame++)
 				{
+					const tPicture* picture = GetPic(frame);
 					frames.Append
 					(
 						new tFrame
@@ -871,7 +1165,7 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			if (!picture || !picture->IsValid())
 				return false;
 
-			tImageBMP bmp(*picture, false);
+			tImageBMP bmp(picture->GetPixelPointer(), picture->GetWidth(), picture->GetHeight(), true);
 			tImageBMP::SaveParams params(SaveParamsBMP);
 			if (useConfigSaveParams)
 			{
@@ -883,6 +1177,7 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 				}
 			}
 			tImageBMP::tFormat savedFormat = bmp.Save(outFile, params);
+			bmp.StealPixels();
 			success = (savedFormat != tImageBMP::tFormat::Invalid);
 			break;
 		}
@@ -906,9 +1201,10 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 			}
 			else
 			{
-				const tList<tImage::tPicture>& pics = GetPictures();
-				for (tPicture* picture = pics.First(); picture; picture = picture->Next())
+				int numFrames = GetNumFrames();
+				for (int frame = 0; frame < numFrames; frame++)
 				{
+					const tPicture* picture = GetPic(frame);
 					frames.Append
 					(
 						new tFrame
@@ -938,179 +1234,649 @@ bool Image::Save(const tString& outFile, tFileType fileType, bool useConfigSaveP
 }
 
 
-int Image::GetMemSizeBytes() const
+void Image::RebuildFrameTable()
 {
-	int numBytes = 0;
+	FrameTable.clear();
+	FrameTable.reserve(Pictures.GetNumItems());
 	for (tPicture* pic = Pictures.First(); pic; pic = pic->Next())
-		numBytes += pic->GetNumPixels() * sizeof(tPixel4b);
-
-	numBytes += AltPicture.IsValid() ? AltPicture.GetNumPixels()*sizeof(tPixel4b) : 0;
-	return numBytes;
+		FrameTable.push_back(pic);
 }
 
 
-void Image::MultiSurfacePopulatePictures(const tBaseImage& img)
+void Image::ForEachPicture(const std::function<void(tPicture*)>& func, int64 frameWorkBytes)
 {
-	if (img.IsCubemap())
+	std::vector<tPicture*> pictures;
+	pictures.reserve(Pictures.GetNumItems());
+	int64 maxArea = 0;
+	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 	{
-		// Cubemaps sides use a left-hand coordinate system with +Z facing the front and +Y up. We want the front (+Z)
-		// to be the first image because it makes the most sense from a viewing perspective. In the tImage the sides
-		// are loaded in the +X,-X,+Y,-Y,+Z,-Z order. We display in +Z,-Z,+X,-X,+Y,-Y order.
-		const int numFaces = tFaceIndex_NumFaces;
-		int faceOrder[numFaces] = { tFaceIndex_PosZ, tFaceIndex_NegZ, tFaceIndex_PosX, tFaceIndex_NegX, tFaceIndex_PosY, tFaceIndex_NegY };
-
-		// Note that a teList does not own the items and will not delete them.
-		teList<tLayer> layers[numFaces];
-		img.GetCubemapLayers(layers);
-		for (int f = 0; f < int(tFaceIndex_NumFaces); f++)
-		{
-			int face = faceOrder[f];
-
-			// Grab every mipmap of each cubemap side.
-			for (tLayer* sideMipLayer = layers[face].First(); sideMipLayer; sideMipLayer = sideMipLayer->Next())
-			{
-				tAssert(sideMipLayer->PixelFormat == tPixelFormat::R8G8B8A8);
-				Pictures.Append(new tPicture(sideMipLayer->Width, sideMipLayer->Height, (tPixel4b*)sideMipLayer->Data, true));
-			}
-		}
-		MultiSurfaceCreateAltCubemapPicture(layers);
+		pictures.push_back(picture);
+		tiClampMin(maxArea, int64(picture->GetWidth()) * int64(picture->GetHeight()));
 	}
-	else
-	{
-		teList<tLayer> layers;
-		img.GetLayers(layers);
 
-		int numMipmaps = layers.GetNumItems();
-		for (tLayer* layer = layers.First(); layer; layer = layer->Next())
-			Pictures.Append(new tPicture(layer->Width, layer->Height, (tPixel4b*)layer->Data, true));
+	if (frameWorkBytes <= 0)
+		frameWorkBytes = 2 * maxArea * int64(sizeof(tPixel4b));
+	int maxThreads = int(tClamp(ParallelEditMaxBytes / tClampMin(frameWorkBytes, int64(1)), int64(1), int64(Parallel::GetNumThreads())));
 
-		if (img.IsMipmapped())
-			MultiSurfaceCreateAltMipmapPicture(layers);
-	}
+	Parallel::For(int(pictures.size()), [&](int p) { func(pictures[p]); }, maxThreads);
 }
 
 
-void Image::MultiSurfaceCreateAltCubemapPicture(const teList<tLayer> layers[tFaceIndex::tFaceIndex_NumFaces])
+int Image::GetNumFrames() const
 {
-	tAssert(!layers[0].IsEmpty());
-	int w = layers[0].First()->Width;
-	int h = layers[0].First()->Height;
-	AltPicture.Set(w*4, h*3, tPixel4b::transparent);
+	if (!CompressedFrames.empty())
+		return int(CompressedFrames.size());
+
+	if (!DeltaFrames.empty())
+		return int(DeltaFrames.size());
+
+	return Pictures.Count();
+}
 
-	// Cubemaps sides use a left-hand coordinate system with +Z facing the front and +Y up. We want the front (+Z)
-	// to be the first image because it makes the most sense from a viewing perspective. In the tImage the sides
-	// are loaded in the +X,-X,+Y,-Y,+Z,-Z order. We display in +Z,-Z,+X,-X,+Y,-Y order.
-	const int numFaces = tFaceIndex_NumFaces;
-	struct FaceInfo { int Face; int OriginX; int OriginY; };
-	FaceInfo faceInfo[numFaces] =
-	{
-		{ tFaceIndex_PosZ, w,	h	},
-		{ tFaceIndex_NegZ, 3*w,	h	},
-		{ tFaceIndex_PosX, 2*w,	h	},
-		{ tFaceIndex_NegX, 0,	h	},
-		{ tFaceIndex_PosY, w,	2*h	},
-		{ tFaceIndex_NegY, w,	0	}
-	};
 
-	for (int f = 0; f < int(tFaceIndex_NumFaces); f++)
+tPicture* Image::GetPic(int frameNum) const
+{
+	if (!CompressedFrames.empty())
 	{
-		int face = faceInfo[f].Face;
-		int originX = faceInfo[f].OriginX;
-		int originY = faceInfo[f].OriginY;
+		if ((frameNum < 0) || (frameNum >= int(CompressedFrames.size())))
+			return nullptr;
 
-		tLayer* topMip = layers[face].First();
-		tAssert(topMip->PixelFormat == tPixelFormat::R8G8B8A8);
-		for (int y = 0; y < topMip->Height; y++)
-			for (int x = 0; x < topMip->Width; x++)
-				AltPicture.SetPixel(originX + x, originY + y, topMip->GetPixel(x, y));
+		CompressedFrame& frame = CompressedFrames[frameNum];
+		frame.LastUse = ++CompressedUseCount;
+		if (!frame.Decoded)
+		{
+			DecodeCompressedFrame(frameNum);
+			EvictDecodedFrames(frameNum);
+		}
+		return frame.Decoded;
 	}
-	AltPictureTyp = AltPictureType::CubemapTLayout;
+
+	if (DeltaFrames.empty())
+		return ((frameNum >= 0) && (frameNum < int(FrameTable.size()))) ? FrameTable[frameNum] : nullptr;
+
+	if ((frameNum < 0) || (frameNum >= int(DeltaFrames.size())))
+		return nullptr;
+
+	MaterializeDeltaFrame(frameNum);
+	return Pictures.First();
 }
 
 
-void Image::MultiSurfaceCreateAltMipmapPicture(const teList<tLayer>& layers)
+bool Image::CompactDeltaFrames()
 {
-	tAssert(!layers.IsEmpty());
-
-	int width = 0;
-	for (tLayer* layer = layers.First(); layer; layer = layer->Next())
-		width += layer->Width;
-	int height = layers.First()->Height;
+	tAssert(DeltaFrames.empty());
+	int numFrames = Pictures.Count();
+	if ((numFrames < 2) || (AltPictureTyp != AltPictureType::None))
+		return false;
 
-	AltPicture.Set(width, height, tPixel4b::transparent);
-	int originY = 0;
-	int originX = 0;
-	for (tLayer* mipPic = layers.First(); mipPic; mipPic = mipPic->Next())
+	tPicture* first = Pictures.First();
+	int width = first->GetWidth();
+	int height = first->GetHeight();
+	for (tPicture* pic = first; pic; pic = pic->Next())
+		if (!pic->IsValid() || (pic->GetWidth() != width) || (pic->GetHeight() != height))
+			return false;
+
+	// First pass just finds the dirty rect of each frame so we can bail before allocating anything if it isn't worth it.
+	std::vector<DeltaFrame> deltas(numFrames);
+	int64 fullPixels = int64(width)*int64(height)*int64(numFrames);
+	int64 deltaPixels = 0;
+	const int rowBytes = width*sizeof(tPixel4b);
+	int frame = 0;
+	for (tPicture* pic = first; pic; pic = pic->Next(), frame++)
 	{
-		for (int y = 0; y < mipPic->Height; y++)
+		DeltaFrame& delta = deltas[frame];
+		delta.Duration = pic->Duration;
+		tPicture* prev = pic->Prev();
+		if (!prev || ((frame % DeltaKeyframeInterval) == 0))
 		{
-			for (int x = 0; x < mipPic->Width; x++)
-			{
-				tPixel4b pixel = mipPic->GetPixel(x, y);
-				AltPicture.SetPixel(originX + x, y, pixel);
-			}
+			delta.Keyframe = true;
+			delta.W = width;	delta.H = height;
+			deltaPixels += int64(width)*int64(height);
+			continue;
 		}
-		originX += mipPic->Width;
-	}
-	AltPictureTyp = AltPictureType::MipmapSideBySide;
-}
 
+		int minY = 0;
+		while ((minY < height) && !tMemcmp(pic->GetPixelPointer(0, minY), prev->GetPixelPointer(0, minY), rowBytes))
+			minY++;
 
-bool Image::Unload(bool force)
-{
-	if (!IsLoaded())
-		return true;
+		// Identical frames are common in recordings. An empty rect means nothing to apply.
+		if (minY == height)
+			continue;
 
-	// Not allowed to unload if dirty (modified).
-	if (Dirty && !force)
+		int maxY = height-1;
+		while ((maxY > minY) && !tMemcmp(pic->GetPixelPointer(0, maxY), prev->GetPixelPointer(0, maxY), rowBytes))
+			maxY--;
+
+		int minX = width-1;
+		int maxX = 0;
+		for (int y = minY; y <= maxY; y++)
+		{
+			const tPixel4b* curr = pic->GetPixelPointer(0, y);
+			const tPixel4b* last = prev->GetPixelPointer(0, y);
+			for (int x = 0; x < minX; x++)
+				if (curr[x] != last[x]) { minX = x; break; }
+			for (int x = width-1; x > maxX; x--)
+				if (curr[x] != last[x]) { maxX = x; break; }
+		}
+		if (maxX < minX)
+			maxX = minX;
+
+		delta.X = minX;			delta.Y = minY;
+		delta.W = maxX-minX+1;	delta.H = maxY-minY+1;
+		deltaPixels += int64(delta.W)*int64(delta.H);
+	}
+
+	if (deltaPixels*2 > fullPixels)
 		return false;
 
+	frame = 0;
+	for (tPicture* pic = first; pic; pic = pic->Next(), frame++)
+	{
+		DeltaFrame& delta = deltas[frame];
+		delta.Pixels.resize(delta.W*delta.H);
+		for (int r = 0; r < delta.H; r++)
+			tMemcpy(&delta.Pixels[r*delta.W], pic->GetPixelPointer(delta.X, delta.Y+r), delta.W*sizeof(tPixel4b));
+	}
+
+	// A copy of the last picture becomes the scratch.
 	Unbind();
-	AltPicture.Clear();
-	AltPictureEnabled = false;
-	AltPictureTyp = AltPictureType::None;
+	tPicture* scratch = new tPicture(*Pictures.Last());
 	Pictures.Clear();
-	Info.MemSizeBytes = 0;
+	Pictures.Append(scratch);
+	RebuildFrameTable();
 
-	LoadedTime = -1.0f;
+	DeltaFrames = std::move(deltas);
+	DeltaScratchFrame = numFrames-1;
+	DeltaBoundFrame = -1;
 	return true;
 }
 
 
-bool Image::IsOpaque() const
+void Image::ExpandDeltaFrames()
 {
-	if (AltPicture.IsValid() && AltPictureEnabled)
-		return AltPicture.IsOpaque();
+	if (DeltaFrames.empty())
+		return;
 
-	tPicture* picture = GetCurrentPic();
-	if (picture && picture->IsValid())
-		return picture->IsOpaque();
+	Unbind();
+	int numFrames = int(DeltaFrames.size());
+	std::vector<tPicture*> pictures(numFrames);
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		MaterializeDeltaFrame(frame);
+		pictures[frame] = new tPicture(*Pictures.First());
+	}
 
-	return true;
+	DeltaFrames.clear();
+	DeltaScratchFrame = -1;
+	DeltaBoundFrame = -1;
+	Pictures.Clear();
+	for (tPicture* pic : pictures)
+		Pictures.Append(pic);
+	RebuildFrameTable();
+	Info.MemSizeBytes = GetMemSizeBytes();
 }
 
 
-int Image::GetWidth() const
+void Image::MaterializeDeltaFrame(int frameNum) const
 {
-	if (AltPicture.IsValid() && AltPictureEnabled)
-		return AltPicture.GetWidth();
+	if (frameNum == DeltaScratchFrame)
+		return;
 
-	tPicture* picture = GetCurrentPic();
-	if (picture && picture->IsValid())
-		return picture->GetWidth();
+	// Replay from the nearest keyframe at or before the frame, or from the scratch if it is already on the way.
+	int start = frameNum;
+	while (!DeltaFrames[start].Keyframe)
+		start--;
+	if ((DeltaScratchFrame >= start) && (DeltaScratchFrame < frameNum))
+		start = DeltaScratchFrame+1;
 
-	return 0;
+	tPicture* scratch = Pictures.First();
+	for (int frame = start; frame <= frameNum; frame++)
+	{
+		const DeltaFrame& delta = DeltaFrames[frame];
+		for (int r = 0; r < delta.H; r++)
+			tMemcpy(scratch->GetPixelPointer(delta.X, delta.Y+r), &delta.Pixels[r*delta.W], delta.W*sizeof(tPixel4b));
+	}
+	scratch->Duration = DeltaFrames[frameNum].Duration;
+	DeltaScratchFrame = frameNum;
 }
 
 
-int Image::GetHeight() const
+template<typename ImageType> bool Image::LoadCompressedResident(typename ImageType::LoadParams params)
 {
-	if (AltPicture.IsValid() && AltPictureEnabled)
-		return AltPicture.GetHeight();
+	// Gamma and sRGB corrections are only applied by the loader while it decodes. Our own decode would not apply them.
+	if (params.Flags & (ImageType::LoadFlag_GammaCompression | ImageType::LoadFlag_SRGBCompression))
+		return false;
+
+	// Rows are left in file order. DecodeCompressedFrame reverses them after decoding, which works for any block size.
+	params.Flags &= ~(ImageType::LoadFlag_Decode | ImageType::LoadFlag_ReverseRowOrder);
+	ImageType img;
+	if (!LoadImageType(img, params) || !img.IsValid())
+		return false;
+
+	if ((params.Flags & ImageType::LoadFlag_AutoGamma) && tIsProfileLinearInRGB(img.GetColourProfileSrc()))
+		return false;
+
+	if ((params.Flags & ImageType::LoadFlag_ToneMapExposure) && tIsASTCFormat(img.GetPixelFormatSrc()))
+		return false;
+
+	if constexpr (std::is_same_v<ImageType, tImageASTC>)
+	{
+		tLayer* layer = img.StealLayer();
+		if (!layer || !IsCompressedResidentFormat(layer->PixelFormat))
+		{
+			delete layer;
+			return false;
+		}
+		CompressedFrames.resize(1);
+		CompressedFrames[0].Layer = layer;
+	}
+	else
+	{
+		if (!PopulateCompressedFrames(img))
+			return false;
+
+		Info.AlphaMode		= img.GetAlphaMode();
+		Info.ChannelType	= img.GetChannelType();
+	}
+
+	Info.SrcPixelFormat		= img.GetPixelFormatSrc();
+	Info.SrcColourProfile	= img.GetColourProfileSrc();
+	return true;
+}
+
+
+bool Image::PopulateCompressedFrames(const tBaseImage& img)
+{
+	// Same picture order as MultiSurfacePopulatePictures.
+	std::vector<tLayer*> layers;
+	if (img.IsCubemap())
+	{
+		const int numFaces = tFaceIndex_NumFaces;
+		int faceOrder[numFaces] = { tFaceIndex_PosZ, tFaceIndex_NegZ, tFaceIndex_PosX, tFaceIndex_NegX, tFaceIndex_PosY, tFaceIndex_NegY };
+		teList<tLayer> faceLayers[numFaces];
+		img.GetCubemapLayers(faceLayers);
+		for (int f = 0; f < numFaces; f++)
+			for (tLayer* layer = faceLayers[faceOrder[f]].First(); layer; layer = layer->Next())
+				layers.push_back(layer);
+	}
+	else
+	{
+		teList<tLayer> mipLayers;
+		img.GetLayers(mipLayers);
+		for (tLayer* layer = mipLayers.First(); layer; layer = layer->Next())
+			layers.push_back(layer);
+	}
+
+	if (layers.empty())
+		return false;
+
+	for (tLayer* layer : layers)
+		if (!IsCompressedResidentFormat(layer->PixelFormat))
+			return false;
+
+	CompressedFrames.resize(layers.size());
+	for (int f = 0; f < int(layers.size()); f++)
+		CompressedFrames[f].Layer = new tLayer(*layers[f]);
+
+	// The alt picture is built lazily from GetPic so it works the same as for decoded images.
+	if (img.IsCubemap())
+		AltPictureTyp = AltPictureType::CubemapTLayout;
+	else if (img.IsMipmapped())
+		AltPictureTyp = AltPictureType::MipmapSideBySide;
+
+	return true;
+}
+
+
+bool Image::IsCompressedResidentFormat(tPixelFormat format) const
+{
+	// HDR formats need the loader's exposure and gamma handling. Luminance formats may need their channel spread.
+	if (tIsHDRFormat(format) || tIsLuminanceFormat(format))
+		return false;
+
+	return tIsBCFormat(format) || tIsASTCFormat(format) || tIsPVRFormat(format);
+}
+
+
+void Image::DecodeCompressedFrame(int frameNum) const
+{
+	CompressedFrame& frame = CompressedFrames[frameNum];
+	if (frame.Decoded)
+		return;
+
+	const tLayer* layer = frame.Layer;
+	tPixel4b* pixelsLDR = nullptr;
+	tPixel4f* pixelsHDR = nullptr;
+	DecodeResult result = DecodePixelData
+	(
+		layer->PixelFormat, layer->Data, layer->GetDataSize(), layer->Width, layer->Height,
+		pixelsLDR, pixelsHDR
+	);
+
+	if (result != DecodeResult::Success)
+	{
+		delete[] pixelsLDR;
+		delete[] pixelsHDR;
+		pixelsLDR = nullptr;
+		pixelsHDR = nullptr;
+	}
+
+	if (pixelsHDR)
+	{
+		int numPixels = layer->Width*layer->Height;
+		pixelsLDR = new tPixel4b[numPixels];
+		for (int p = 0; p < numPixels; p++)
+			pixelsLDR[p].Set(pixelsHDR[p]);
+		delete[] pixelsHDR;
+	}
+
+	// A failed decode still gets a picture so the frame count and dimensions stay consistent.
+	frame.Decoded = new tPicture();
+	if (pixelsLDR)
+	{
+		frame.Decoded->Set(layer->Width, layer->Height, pixelsLDR, false);
+		frame.Decoded->Flip(false);
+	}
+	else
+	{
+		frame.Decoded->Set(layer->Width, layer->Height, tPixel4b::black);
+	}
+}
+
+
+void Image::EvictDecodedFrames(int keepFrame) const
+{
+	int64 decodedBytes = 0;
+	for (const CompressedFrame& frame : CompressedFrames)
+		if (frame.Decoded)
+			decodedBytes += int64(frame.Decoded->GetNumPixels())*sizeof(tPixel4b);
+
+	while (decodedBytes > DecodedCacheMaxBytes)
+	{
+		// Textures can only be deleted on the main thread, so bound pictures are left for UnbindFramesOutsideWindow.
+		// The primary and current pictures are pinned so pointers from GetPrimaryPic and GetCurrentPic stay valid.
+		int lru = -1;
+		int currFrame = tClampMin(FrameNum, 0);
+		for (int f = 0; f < int(CompressedFrames.size()); f++)
+		{
+			const CompressedFrame& frame = CompressedFrames[f];
+			if (!frame.Decoded || (f == keepFrame) || (f == 0) || (f == currFrame) || (frame.Decoded->TextureID != 0))
+				continue;
+			if ((lru == -1) || (frame.LastUse < CompressedFrames[lru].LastUse))
+				lru = f;
+		}
+		if (lru == -1)
+			break;
+
+		decodedBytes -= int64(CompressedFrames[lru].Decoded->GetNumPixels())*sizeof(tPixel4b);
+		delete CompressedFrames[lru].Decoded;
+		CompressedFrames[lru].Decoded = nullptr;
+	}
+}
+
+
+void Image::ExpandCompressedFrames()
+{
+	if (CompressedFrames.empty())
+		return;
+
+	Unbind();
+	tAssert(Pictures.IsEmpty());
+	int numFrames = int(CompressedFrames.size());
+	for (int f = 0; f < numFrames; f++)
+	{
+		DecodeCompressedFrame(f);
+		Pictures.Append(CompressedFrames[f].Decoded);
+		CompressedFrames[f].Decoded = nullptr;
+	}
+
+	ClearCompressedFrames();
+	RebuildFrameTable();
+	Info.MemSizeBytes = GetMemSizeBytes();
+}
+
+
+void Image::ClearCompressedFrames()
+{
+	for (CompressedFrame& frame : CompressedFrames)
+	{
+		delete frame.Layer;
+		delete frame.Decoded;
+	}
+	CompressedFrames.clear();
+	CompressedUseCount = 0;
+}
+
+
+int Image::GetMemSizeBytes() const
+{
+	int numBytes = 0;
+	for (tPicture* pic = Pictures.First(); pic; pic = pic->Next())
+		numBytes += pic->GetNumPixels() * sizeof(tPixel4b);
+
+	for (const DeltaFrame& delta : DeltaFrames)
+		numBytes += int(delta.Pixels.size() * sizeof(tPixel4b));
+
+	for (const CompressedFrame& frame : CompressedFrames)
+	{
+		numBytes += frame.Layer->GetDataSize();
+		numBytes += frame.Decoded ? frame.Decoded->GetNumPixels()*sizeof(tPixel4b) : 0;
+	}
+
+	numBytes += AltPicture.IsValid() ? AltPicture.GetNumPixels()*sizeof(tPixel4b) : 0;
+	numBytes += int(LayerCacheBytes);
+	return numBytes;
+}
 
-	tPicture* picture = GetCurrentPic();
-	if (picture && picture->IsValid())
-		return picture->GetHeight();
+
+void Image::MultiSurfacePopulatePictures(const tBaseImage& img)
+{
+	if (img.IsCubemap())
+	{
+		// Cubemaps sides use a left-hand coordinate system with +Z facing the front and +Y up. We want the front (+Z)
+		// to be the first image because it makes the most sense from a viewing perspective. In the tImage the sides
+		// are loaded in the +X,-X,+Y,-Y,+Z,-Z order. We display in +Z,-Z,+X,-X,+Y,-Y order.
+		const int numFaces = tFaceIndex_NumFaces;
+		int faceOrder[numFaces] = { tFaceIndex_PosZ, tFaceIndex_NegZ, tFaceIndex_PosX, tFaceIndex_NegX, tFaceIndex_PosY, tFaceIndex_NegY };
+
+		// Note that a teList does not own the items and will not delete them.
+		teList<tLayer> layers[numFaces];
+		img.GetCubemapLayers(layers);
+		for (int f = 0; f < int(tFaceIndex_NumFaces); f++)
+		{
+			int face = faceOrder[f];
+
+			// Grab every mipmap of each cubemap side.
+			for (tLayer* sideMipLayer = layers[face].First(); sideMipLayer; sideMipLayer = sideMipLayer->Next())
+			{
+				tAssert(sideMipLayer->PixelFormat == tPixelFormat::R8G8B8A8);
+				Pictures.Append(new tPicture(sideMipLayer->Width, sideMipLayer->Height, (tPixel4b*)sideMipLayer->Data, true));
+			}
+		}
+
+		// The alt picture itself is only built if it gets enabled.
+		AltPictureTyp = AltPictureType::CubemapTLayout;
+	}
+	else
+	{
+		teList<tLayer> layers;
+		img.GetLayers(layers);
+
+		int numMipmaps = layers.GetNumItems();
+		for (tLayer* layer = layers.First(); layer; layer = layer->Next())
+			Pictures.Append(new tPicture(layer->Width, layer->Height, (tPixel4b*)layer->Data, true));
+
+		if (img.IsMipmapped())
+			AltPictureTyp = AltPictureType::MipmapSideBySide;
+	}
+}
+
+
+void Image::EnableAltPicture(bool enabled)
+{
+	AltPictureEnabled = enabled;
+	if (enabled && !AltPicture.IsValid())
+	{
+		switch (AltPictureTyp)
+		{
+			case AltPictureType::CubemapTLayout:	MultiSurfaceCreateAltCubemapPicture();	break;
+			case AltPictureType::MipmapSideBySide:	MultiSurfaceCreateAltMipmapPicture();	break;
+			default:																		break;
+		}
+	}
+	else if (!enabled && AltPicture.IsValid())
+	{
+		if (TexIDAlt != 0)
+		{
+			glDeleteTextures(1, &TexIDAlt);
+			TexIDAlt = 0;
+		}
+		AltPicture.Clear();
+	}
+	Info.MemSizeBytes = GetMemSizeBytes();
+}
+
+
+void Image::MultiSurfaceCreateAltCubemapPicture()
+{
+	// The Pictures are every mipmap of each side, with the sides already in display order.
+	const int numFaces = tFaceIndex_NumFaces;
+	int numMips = GetNumFrames() / numFaces;
+	tPicture* front = GetPic(0);
+	if ((numMips <= 0) || !front)
+		return;
+
+	int w = front->GetWidth();
+	int h = front->GetHeight();
+	AltPicture.Set(w*4, h*3, tPixel4b::transparent);
+
+	// Cubemaps sides use a left-hand coordinate system with +Z facing the front and +Y up. The sides are displayed in
+	// +Z,-Z,+X,-X,+Y,-Y order.
+	struct FaceInfo { int Face; int OriginX; int OriginY; };
+	FaceInfo faceInfo[numFaces] =
+	{
+		{ tFaceIndex_PosZ, w,	h	},
+		{ tFaceIndex_NegZ, 3*w,	h	},
+		{ tFaceIndex_PosX, 2*w,	h	},
+		{ tFaceIndex_NegX, 0,	h	},
+		{ tFaceIndex_PosY, w,	2*h	},
+		{ tFaceIndex_NegY, w,	0	}
+	};
+
+	for (int f = 0; f < numFaces; f++)
+	{
+		int originX = faceInfo[f].OriginX;
+		int originY = faceInfo[f].OriginY;
+
+		// Each side is copied a row at a time. GetPic may decode the side if compressed-resident.
+		tPicture* topMip = GetPic(f*numMips);
+		if (!topMip || (topMip->GetWidth() != w) || (topMip->GetHeight() != h))
+			continue;
+
+		for (int y = 0; y < h; y++)
+			tMemcpy(AltPicture.GetPixelPointer(originX, originY + y), topMip->GetPixelPointer(0, y), w*sizeof(tPixel4b));
+	}
+}
+
+
+void Image::MultiSurfaceCreateAltMipmapPicture()
+{
+	int numMips = GetNumFrames();
+	tPicture* topMip = GetPic(0);
+	if (!topMip)
+		return;
+
+	// Sum the widths without touching the pictures so compressed-resident mipmaps are only decoded once.
+	int width = 0;
+	for (int m = 0; m < numMips; m++)
+		width += tGetMipmapDim(topMip->GetWidth(), m);
+	int height = topMip->GetHeight();
+
+	AltPicture.Set(width, height, tPixel4b::transparent);
+	int originX = 0;
+	for (int m = 0; m < numMips; m++)
+	{
+		tPicture* mipPic = GetPic(m);
+		int mipW = mipPic->GetWidth();
+		if (originX + mipW > width)
+			break;
+		for (int y = 0; y < mipPic->GetHeight(); y++)
+			tMemcpy(AltPicture.GetPixelPointer(originX, y), mipPic->GetPixelPointer(0, y), mipW*sizeof(tPixel4b));
+		originX += mipW;
+	}
+}
+
+
+bool Image::Unload(bool force)
+{
+	if (!IsLoaded())
+		return true;
+
+	// Not allowed to unload if dirty (modified).
+	if (Dirty && !force)
+		return false;
+
+	CancelReload();
+	ReleaseFileData();
+	FreeLoaded();
+	return true;
+}
+
+
+void Image::FreeLoaded()
+{
+	CancelLayerJob();
+	Unbind();
+	AltPicture.Clear();
+	AltPictureEnabled = false;
+	AltPictureTyp = AltPictureType::None;
+	Pictures.Clear();
+	RebuildFrameTable();
+	DeltaFrames.clear();
+	DeltaScratchFrame = -1;
+	DeltaBoundFrame = -1;
+	ClearCompressedFrames();
+	ClearLayerCache();
+	Info.MemSizeBytes = 0;
+
+	LoadedTime = -1.0f;
+}
+
+
+bool Image::IsOpaque() const
+{
+	if (AltPicture.IsValid() && AltPictureEnabled)
+		return AltPicture.IsOpaque();
+
+	tPicture* picture = GetCurrentPic();
+	if (picture && picture->IsValid())
+		return picture->IsOpaque();
+
+	return true;
+}
+
+
+int Image::GetWidth() const
+{
+	if (AltPicture.IsValid() && AltPictureEnabled)
+		return AltPicture.GetWidth();
+
+	tPicture* picture = GetCurrentPic();
+	if (picture && picture->IsValid())
+		return picture->GetWidth();
+
+	return 0;
+}
+
+
+int Image::GetHeight() const
+{
+	if (AltPicture.IsValid() && AltPictureEnabled)
+		return AltPicture.GetHeight();
+
+	tPicture* picture = GetCurrentPic();
+	if (picture && picture->IsValid())
+		return picture->GetHeight();
 
 	return 0;
 }
@@ -1148,8 +1914,7 @@ void Image::Rotate90(bool antiClockWise)
 {
 	tString desc; tsPrintf(desc, "Rotate 90 %s", antiClockWise ? "ACW" : "CW");
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Rotate90(antiClockWise);
+	ForEachPicture([&](tPicture* picture) { picture->Rotate90(antiClockWise); });
 
 	Dirty = true;
 }
@@ -1162,20 +1927,61 @@ bool Image::Rotate(float angle, const tColour4b& fill, tResampleFilter upFilter,
 
 	tString desc; tsPrintf(desc, "Rotate %.1f", tRadToDeg(angle));
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->RotateCenter(angle, fill, upFilter, downFilter);
+	ForEachPicture([&](tPicture* picture) { Resampler::RotateCenter(*picture, angle, fill, upFilter, downFilter); });
 
 	Dirty = true;
 	return true;
 }
 
 
+void Image::CopyPictures(tList<tPicture>& pictures) const
+{
+	int numFrames = GetNumFrames();
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		const tPicture* picture = GetPic(frame);
+		if (picture)
+			pictures.Append(new tPicture(*picture));
+	}
+}
+
+
+void Image::SetPictures(tList<tPicture>& pictures, const tString& desc)
+{
+	Unbind();
+	PushUndo(desc);
+	Pictures.Clear();
+	AdjustPicture = nullptr;
+	AdjustAllBegun = false;
+	while (tPicture* picture = pictures.Remove())
+		Pictures.Append(picture);
+	RebuildFrameTable();
+	FrameNum = tClamp(FrameNum, 0, tClampMin(GetNumFrames()-1, 0));
+	Dirty = true;
+}
+
+
 void Image::QuantizeFixed(int numColours, bool checkExact)
 {
 	tString desc; tsPrintf(desc, "Quantize %d", numColours);
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->QuantizeFixed(numColours, checkExact);
+
+	// The fixed palette does not depend on the pixels so it is fetched once and every picture is mapped to it with the
+	// accelerated lookup. A single picture is mapped in parallel chunks, multiple pictures one per thread. A picture
+	// that already has few enough colours is left alone, which is what an exact quantize would produce.
+	tiClamp(numColours, 2, 256);
+	tColour3b palette[256];
+	PaletteMap::GetFixedPalette(palette, numColours);
+	PaletteMap paletteMap(palette, numColours);
+	ForEachPicture
+	(
+		[&](tPicture* picture)
+		{
+			if (checkExact && PaletteMap::HasAtMostColours(picture->GetPixelPointer(), picture->GetArea(), numColours))
+				return;
+			paletteMap.MapPixels(picture->GetPixelPointer(), picture->GetArea());
+		}
+	);
 
 	Dirty = true;
 }
@@ -1185,6 +1991,7 @@ void Image::QuantizeSpatial(int numColours, bool checkExact, double ditherLevel,
 {
 	tString desc; tsPrintf(desc, "Quantize %d", numColours);
 	PushUndo(desc);
+	const std::lock_guard<std::mutex> lock(GetQuantizeMutex());
 	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 		picture->QuantizeSpatial(numColours, checkExact, ditherLevel, filterSize);
 
@@ -1196,6 +2003,7 @@ void Image::QuantizeNeu(int numColours, bool checkExact, int sampleFactor)
 {
 	tString desc; tsPrintf(desc, "Quantize %d", numColours);
 	PushUndo(desc);
+	const std::lock_guard<std::mutex> lock(GetQuantizeMutex());
 	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 		picture->QuantizeNeu(numColours, checkExact, sampleFactor);
 
@@ -1207,6 +2015,7 @@ void Image::QuantizeWu(int numColours, bool checkExact)
 {
 	tString desc; tsPrintf(desc, "Quantize %d", numColours);
 	PushUndo(desc);
+	const std::lock_guard<std::mutex> lock(GetQuantizeMutex());
 	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 		picture->QuantizeWu(numColours, checkExact);
 
@@ -1220,19 +2029,35 @@ bool Image::AdjustmentBegin()
 		return false;
 
 	PushUndo("Levels");
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->AdjustmentBegin();
+	AdjustPicture = GetCurrentPic();
+	if (!AdjustPicture)
+		return false;
 
+	AdjustPicture->AdjustmentBegin();
+	AdjustAllBegun = (Pictures.GetNumItems() == 1);
 	return true;
 }
 
 
+void Image::AdjustBeginAll()
+{
+	if (AdjustAllBegun || !AdjustPicture)
+		return;
+
+	tPicture* begun = AdjustPicture;
+	ForEachPicture([begun](tPicture* picture) { if (picture != begun) picture->AdjustmentBegin(); });
+	AdjustAllBegun = true;
+}
+
+
 void Image::AdjustBrightness(float brightness, AdjChan channels, bool allFrames)
 {
+	// The layer worker may be reading the pixels, and any cached layers are about to be stale.
+	ClearLayerCache();
 	if (allFrames)
 	{
-		for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-			picture->AdjustBrightness(brightness, ComponentBits(channels));
+		AdjustBeginAll();
+		ForEachPicture([&](tPicture* picture) { picture->AdjustBrightness(brightness, ComponentBits(channels)); });
 	}
 	else
 	{
@@ -1246,10 +2071,11 @@ void Image::AdjustBrightness(float brightness, AdjChan channels, bool allFrames)
 
 void Image::AdjustContrast(float contrast, AdjChan channels, bool allFrames)
 {
+	ClearLayerCache();
 	if (allFrames)
 	{
-		for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-			picture->AdjustContrast(contrast, ComponentBits(channels));
+		AdjustBeginAll();
+		ForEachPicture([&](tPicture* picture) { picture->AdjustContrast(contrast, ComponentBits(channels)); });
 	}
 	else
 	{
@@ -1263,10 +2089,11 @@ void Image::AdjustContrast(float contrast, AdjChan channels, bool allFrames)
 
 void Image::AdjustLevels(float blackPoint, float midPoint, float whitePoint, float blackOut, float whiteOut, bool powerMidGamma, AdjChan channels, bool allFrames)
 {
+	ClearLayerCache();
 	if (allFrames)
 	{
-		for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-			picture->AdjustLevels(blackPoint, midPoint, whitePoint, blackOut, whiteOut, powerMidGamma, ComponentBits(channels));
+		AdjustBeginAll();
+		ForEachPicture([&](tPicture* picture) { picture->AdjustLevels(blackPoint, midPoint, whitePoint, blackOut, whiteOut, powerMidGamma, ComponentBits(channels)); });
 	}
 	else
 	{
@@ -1280,11 +2107,14 @@ void Image::AdjustLevels(float blackPoint, float midPoint, float whitePoint, flo
 
 void Image::AdjustRestoreOriginal(bool popUndo)
 {
+	ClearLayerCache();
 	if (popUndo)
 		PopUndo();
 
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->AdjustRestoreOriginal();
+	if (AdjustAllBegun)
+		ForEachPicture([](tPicture* picture) { picture->AdjustRestoreOriginal(); });
+	else if (AdjustPicture)
+		AdjustPicture->AdjustRestoreOriginal();
 
 	Dirty = false;
 }
@@ -1303,9 +2133,17 @@ void Image::AdjustGetDefaults(float& brightness, float& contrast, float& blackPo
 
 bool Image::AdjustmentEnd()
 {
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->AdjustmentEnd();
-
+	if (AdjustAllBegun)
+	{
+		for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
+			picture->AdjustmentEnd();
+	}
+	else if (AdjustPicture)
+	{
+		AdjustPicture->AdjustmentEnd();
+	}
+	AdjustPicture = nullptr;
+	AdjustAllBegun = false;
 	return true;
 }
 
@@ -1314,8 +2152,7 @@ void Image::Flip(bool horizontal)
 {
 	tString desc; tsPrintf(desc, "Flip %s", horizontal ? "Horiz" : "Vert");
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Flip(horizontal);
+	ForEachPicture([&](tPicture* picture) { picture->Flip(horizontal); });
 
 	Dirty = true;
 }
@@ -1323,6 +2160,8 @@ void Image::Flip(bool horizontal)
 
 bool Image::Crop(int newWidth, int newHeight, int originX, int originY, const tColour4b& fillColour)
 {
+	// The size check below needs every frame in the Pictures list.
+	ExpandFrames();
 	bool atLeastOneDifferentSize = false;
 	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 	{
@@ -1337,8 +2176,7 @@ bool Image::Crop(int newWidth, int newHeight, int originX, int originY, const tC
 
 	tString desc; tsPrintf(desc, "Crop %d %d", newWidth, newHeight);
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Crop(newWidth, newHeight, originX, originY, fillColour);
+	ForEachPicture([&](tPicture* picture) { picture->Crop(newWidth, newHeight, originX, originY, fillColour); }, 2*int64(newWidth)*int64(newHeight)*int64(sizeof(tPixel4b)));
 
 	Dirty = true;
 	return true;
@@ -1347,6 +2185,8 @@ bool Image::Crop(int newWidth, int newHeight, int originX, int originY, const tC
 
 bool Image::Crop(int newWidth, int newHeight, tPicture::Anchor anchor, const tColour4b& fillColour)
 {
+	// The size check below needs every frame in the Pictures list.
+	ExpandFrames();
 	bool atLeastOneDifferentSize = false;
 	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 	{
@@ -1361,8 +2201,7 @@ bool Image::Crop(int newWidth, int newHeight, tPicture::Anchor anchor, const tCo
 
 	tString desc; tsPrintf(desc, "Crop %d %d", newWidth, newHeight);
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Crop(newWidth, newHeight, anchor, fillColour);
+	ForEachPicture([&](tPicture* picture) { picture->Crop(newWidth, newHeight, anchor, fillColour); }, 2*int64(newWidth)*int64(newHeight)*int64(sizeof(tPixel4b)));
 
 	Dirty = true;
 	return true;
@@ -1373,8 +2212,7 @@ bool Image::Paste(int regionW, int regionH, const tColour4b* regionPixels, int o
 {
 	tString desc; tsPrintf(desc, "Paste %d %d", regionW, regionH);
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->CopyRegion(regionW, regionH, regionPixels, originX, originY, channels);
+	ForEachPicture([&](tPicture* picture) { picture->CopyRegion(regionW, regionH, regionPixels, originX, originY, channels); });
 
 	Dirty = true;
 	return true;
@@ -1385,8 +2223,7 @@ bool Image::Paste(int regionW, int regionH, const tColour4b* regionPixels, tImag
 {
 	tString desc; tsPrintf(desc, "Paste %d %d", regionW, regionH);
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->CopyRegion(regionW, regionH, regionPixels, anchor, channels);
+	ForEachPicture([&](tPicture* picture) { picture->CopyRegion(regionW, regionH, regionPixels, anchor, channels); });
 
 	Dirty = true;
 	return true;
@@ -1395,6 +2232,8 @@ bool Image::Paste(int regionW, int regionH, const tColour4b* regionPixels, tImag
 
 bool Image::Deborder(const tColour4b& borderColour, comp_t channels)
 {
+	// Every frame needs to be checked for borders, not just the one materialized for display.
+	ExpandFrames();
 	bool atLeastOneHasBorders = false;
 	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 	{
@@ -1408,16 +2247,17 @@ bool Image::Deborder(const tColour4b& borderColour, comp_t channels)
 		return false;
 
 	PushUndo("Crop Borders");
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Deborder(borderColour, channels);
+	ForEachPicture([&](tPicture* picture) { picture->Deborder(borderColour, channels); });
 
 	Dirty = true;
 	return true;
 }
 
 
-bool Image::Resample(int newWidth, int newHeight, tImage::tResampleFilter filter, tImage::tResampleEdgeMode edgeMode)
+bool Image::Resample(int newWidth, int newHeight, tImage::tResampleFilter filter, tImage::tResampleEdgeMode edgeMode, bool gammaCorrect)
 {
+	// The size check below needs every frame in the Pictures list.
+	ExpandFrames();
 	bool atLeastOneDifferentSize = false;
 	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 	{
@@ -1432,8 +2272,7 @@ bool Image::Resample(int newWidth, int newHeight, tImage::tResampleFilter filter
 
 	tString desc; tsPrintf(desc, "Resample %d %d", newWidth, newHeight);
 	PushUndo(desc);
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Resample(newWidth, newHeight, filter, edgeMode);
+	ForEachPicture([&](tPicture* picture) { Resampler::Resample(*picture, newWidth, newHeight, filter, edgeMode, gammaCorrect); }, 2*int64(newWidth)*int64(newHeight)*int64(sizeof(tPixel4b)));
 
 	Dirty = true;
 	return true;
@@ -1447,6 +2286,11 @@ void Image::SetPixelColour(int x, int y, const tColour4b& colour, bool pushUndo,
 		tString desc; tsPrintf(desc, "Pixel Colour (%d,%d)", x, y);
 		PushUndo(desc);
 	}
+	else
+	{
+		ExpandFrames();
+		ClearLayerCache();
+	}
 
 	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
 	{
@@ -1464,8 +2308,7 @@ void Image::SetAllPixels(const tColour4b& colour, comp_t channels)
 	tString desc; tsPrintf(desc, "Set Pixels (%d,%d,%d,%d)", colour.R, colour.G, colour.B, colour.A);
 	PushUndo(desc);
 
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->SetAll(colour, channels);
+	ForEachPicture([&](tPicture* picture) { picture->SetAll(colour, channels); });
 
 	Dirty = true;
 }
@@ -1479,8 +2322,7 @@ void Image::Spread(tComp channel)
 	tString desc; tsPrintf(desc, "Spread %s", tGetComponentName(channel));
 	PushUndo(desc);
 
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Spread(channel);
+	ForEachPicture([&](tPicture* picture) { picture->Spread(channel); });
 
 	Dirty = true;
 }
@@ -1500,8 +2342,7 @@ void Image::Swizzle(tComp R, tComp G, tComp B, tComp A)
 	tString desc; tsPrintf(desc, "Swizzle %s", channelsStr.Chr());
 	PushUndo(desc);
 
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Swizzle(R, G, B, A);
+	ForEachPicture([&](tPicture* picture) { picture->Swizzle(R, G, B, A); });
 
 	Dirty = true;
 }
@@ -1519,8 +2360,7 @@ void Image::Intensity(comp_t channels)
 	tString desc; tsPrintf(desc, "Intensity %s", channelsStr.Chr());
 	PushUndo(desc);
 
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->Intensity(channels);
+	ForEachPicture([&](tPicture* picture) { picture->Intensity(channels); });
 
 	Dirty = true;
 }
@@ -1531,8 +2371,7 @@ void Image::AlphaBlendColour(const tColour4b& colour, comp_t channels, int final
 	tString desc; tsPrintf(desc, "Blend (%d,%d,%d,%d)", colour.R, colour.G, colour.B, colour.A);
 	PushUndo(desc);
 
-	for (tPicture* picture = Pictures.First(); picture; picture = picture->Next())
-		picture->AlphaBlendColour(colour, channels, finalAlpha);
+	ForEachPicture([&](tPicture* picture) { picture->AlphaBlendColour(colour, channels, finalAlpha); });
 
 	Dirty = true;
 }
@@ -1561,6 +2400,10 @@ void Image::SetFrameDuration(float duration, bool allFrames)
 
 uint64 Image::Bind()
 {
+	// A finished background reload replaces the pictures before anything is bound.
+	UpdateReload();
+	UpdateLayerJob();
+
 	// We bind in a particular order starting with alternate picture if enabled and valid and
 	// then current picture. In all cases if the texture ID is already valid, we use it right away and early exit.
 	Config::ProfileData& profile = Config::GetProfileData();
@@ -1582,6 +2425,10 @@ uint64 Image::Bind()
 		return TexIDAlt;
 	}
 
+	// Delta-stored frames share the scratch picture so its texture is only good for the frame it was created from.
+	if (!DeltaFrames.empty() && (DeltaBoundFrame != FrameNum))
+		Unbind();
+
 	tPicture* currPic = GetCurrentPic();
 	if (currPic && (currPic->TextureID != 0))
 	{
@@ -1594,26 +2441,387 @@ uint64 Image::Bind()
 
 	tiClamp(FrameNum, 0, GetNumPictures()-1);
 
-	// We do this in reverse order so that the last image we bind is the highest resolution image.
-	// This is more efficient when it comes to drawing the image since the lowest mip is likely not
-	// the one we're going to be viewing right after binding.
-	for (tPicture* picture = Pictures.Last(); picture; picture = picture->Prev())
+	// Long animations only keep a window of frames around the playback position bound. Compressed-resident images
+	// work the same way so only the displayed mipmap or face needs decoding. Binding every frame up front
+	// means generating mipmaps and uploading all of them before anything is drawn, and a few thousand 4K frames will
+	// not fit in VRAM anyway. Frames are bound as playback or the scrubber reaches them and released once they fall
+	// outside the window.
+	// Delta-stored images only ever have the scratch picture to bind.
+	if ((GetNumPictures() > FrameBindWindow) || !CompressedFrames.empty() || !DeltaFrames.empty())
+	{
+		BindFrame(FrameNum);
+		UnbindFramesOutsideWindow();
+		EvictLayerCache(this, FrameNum);
+		DeltaBoundFrame = FrameNum;
+		currPic = GetCurrentPic();
+		return currPic ? currPic->TextureID : 0;
+	}
+
+	// Mipmap generation for unbound frames that aren't already cached is done by a worker, spread across the cores.
+	// A cubemap or a short 4K animation would otherwise generate them one picture after another here on the main
+	// thread before anything is drawn. Those frames get a texture with just the top level for now, and UpdateLayerJob
+	// uploads the full chains as they arrive. The GL uploads must stay on this thread.
+	// We go from the last frame to the first so that the last image we bind is the highest resolution image. This is
+	// more efficient when it comes to drawing since the lowest mip is likely not the one we're viewing after binding.
+	std::vector<int> generateFrames;
+	for (int frame = int(FrameTable.size())-1; frame >= 0; frame--)
 	{
-		if (!picture->IsValid())
+		tPicture* picture = FrameTable[frame];
+		if (!picture->IsValid() || (picture->TextureID != 0))
 			continue;
 
-		tAssert(picture->TextureID == 0);
 		glGenTextures(1, &picture->TextureID);
+		if (picture->TextureID == 0)
+			continue;
 
-		tList<tLayer> layers;
-		picture->GenerateLayers(layers, tResampleFilter(profile.MipmapFilter), tResampleEdgeMode::Clamp, profile.MipmapChaining);
-		BindLayers(layers, picture->TextureID);
+		tList<tLayer>* layers = GetCachedLayers(frame);
+		if (layers)
+		{
+			BindLayers(*layers, picture->TextureID);
+		}
+		else
+		{
+			BindTopLevel(*picture, picture->TextureID);
+			generateFrames.push_back(frame);
+		}
 	}
+
+	// Only one job runs at a time. Frames bound while one is running wait for the next.
+	if (LayerThread.joinable())
+		LayerPending.insert(LayerPending.end(), generateFrames.begin(), generateFrames.end());
+	else if (!generateFrames.empty())
+		StartLayerJob(generateFrames);
+
+	DeltaBoundFrame = FrameNum;
 	currPic = GetCurrentPic();
 	return currPic ? currPic->TextureID : 0;
 }
 
 
+void Image::BindFrame(int frameNum)
+{
+	tPicture* picture = GetPic(frameNum);
+	if (!picture || !picture->IsValid() || (picture->TextureID != 0))
+		return;
+
+	tList<tLayer>* layers = GetCachedLayers(frameNum);
+	if (!layers)
+	{
+		Config::ProfileData& profile = Config::GetProfileData();
+		layers = new tList<tLayer>;
+		picture->GenerateLayers(*layers, tResampleFilter(profile.MipmapFilter), tResampleEdgeMode::Clamp, profile.MipmapChaining);
+		CacheLayers(frameNum, layers);
+	}
+
+	glGenTextures(1, &picture->TextureID);
+	if (picture->TextureID == 0)
+		return;
+
+	BindLayers(*layers, picture->TextureID);
+}
+
+
+tList<tLayer>* Image::GetCachedLayers(int frameNum)
+{
+	if ((frameNum < 0) || (frameNum >= int(LayerCache.size())))
+		return nullptr;
+
+	LayerCacheEntry& entry = LayerCache[frameNum];
+	if (!entry.Layers)
+		return nullptr;
+
+	// Layers made with different mipmap preferences are stale. They get replaced by the caller.
+	Config::ProfileData& profile = Config::GetProfileData();
+	if ((entry.Filter != profile.MipmapFilter) || (entry.Chaining != profile.MipmapChaining))
+		return nullptr;
+
+	entry.LastUse = ++LayerCacheUseCount;
+	return entry.Layers;
+}
+
+
+void Image::CacheLayers(int frameNum, tList<tLayer>* layers)
+{
+	if (frameNum < 0)
+	{
+		delete layers;
+		return;
+	}
+
+	if (frameNum >= int(LayerCache.size()))
+		LayerCache.resize(frameNum+1);
+
+	LayerCacheEntry& entry = LayerCache[frameNum];
+	if (entry.Layers != layers)
+		delete entry.Layers;
+	AddLayerCacheBytes(-entry.NumBytes);
+
+	Config::ProfileData& profile = Config::GetProfileData();
+	entry.Layers	= layers;
+	entry.Filter	= profile.MipmapFilter;
+	entry.Chaining	= profile.MipmapChaining;
+	entry.NumBytes	= 0;
+	entry.LastUse	= ++LayerCacheUseCount;
+	for (tLayer* layer = layers->First(); layer; layer = layer->Next())
+		entry.NumBytes += layer->GetDataSize();
+	AddLayerCacheBytes(entry.NumBytes);
+
+	if (std::find(LayerCacheImages.begin(), LayerCacheImages.end(), this) == LayerCacheImages.end())
+		LayerCacheImages.push_back(this);
+}
+
+
+void Image::FreeCachedLayers(int frameNum)
+{
+	LayerCacheEntry& entry = LayerCache[frameNum];
+	AddLayerCacheBytes(-entry.NumBytes);
+	delete entry.Layers;
+	entry = LayerCacheEntry();
+}
+
+
+void Image::AddLayerCacheBytes(int64 numBytes)
+{
+	LayerCacheBytes += numBytes;
+	LayerCacheTotalBytes += numBytes;
+	Info.MemSizeBytes += int(numBytes);
+}
+
+
+void Image::EvictLayerCache(const Image* keepImage, int keepFrame)
+{
+	while (LayerCacheTotalBytes > LayerCacheMaxBytes)
+	{
+		Image* lruImage = nullptr;
+		int lruFrame = -1;
+		for (Image* image : LayerCacheImages)
+		{
+			for (int f = 0; f < int(image->LayerCache.size()); f++)
+			{
+				const LayerCacheEntry& entry = image->LayerCache[f];
+				if (!entry.Layers || ((image == keepImage) && (f == keepFrame)))
+					continue;
+				if (!lruImage || (entry.LastUse < lruImage->LayerCache[lruFrame].LastUse))
+				{
+					lruImage = image;
+					lruFrame = f;
+				}
+			}
+		}
+		if (!lruImage)
+			break;
+
+		lruImage->FreeCachedLayers(lruFrame);
+	}
+}
+
+
+void Image::ClearLayerCache()
+{
+	CancelLayerJob();
+
+	// Only images that were bound have entries. The early out keeps images destroyed on worker threads away from the
+	// shared registry, which only the main thread may touch.
+	if (LayerCache.empty())
+		return;
+
+	for (int f = 0; f < int(LayerCache.size()); f++)
+		FreeCachedLayers(f);
+	LayerCache.clear();
+
+	auto found = std::find(LayerCacheImages.begin(), LayerCacheImages.end(), this);
+	if (found != LayerCacheImages.end())
+		LayerCacheImages.erase(found);
+}
+
+
+void Image::StartLayerJob(const std::vector<int>& frames)
+{
+	// The worker must not read the profile so the mipmap settings are captured here.
+	Config::ProfileData& profile = Config::GetProfileData();
+	LayerFilter = profile.MipmapFilter;
+	LayerChaining = profile.MipmapChaining;
+	tResampleFilter filter = tResampleFilter(LayerFilter);
+	bool chaining = LayerChaining;
+
+	// The current frame goes first since it's the one on screen.
+	std::vector<int> order(frames);
+	auto curr = std::find(order.begin(), order.end(), FrameNum);
+	if (curr != order.end())
+		std::rotate(order.begin(), curr, curr+1);
+
+	std::vector<tPicture*> pictures;
+	for (int frame : order)
+		pictures.push_back(FrameTable[frame]);
+
+	LayerDone = false;
+	LayerCancel = false;
+	LayerThread = std::thread
+	(
+		[this, order, pictures, filter, chaining]()
+		{
+			int numFrames = int(order.size());
+			int batchSize = Parallel::GetNumThreads();
+			for (int batchStart = 0; (batchStart < numFrames) && !LayerCancel; batchStart += batchSize)
+			{
+				int batchCount = tMin(batchSize, numFrames - batchStart);
+				std::vector<tList<tLayer>*> batch(batchCount, nullptr);
+				Parallel::For
+				(
+					batchCount,
+					[&](int b)
+					{
+						if (LayerCancel)
+							return;
+						batch[b] = new tList<tLayer>;
+						pictures[batchStart + b]->GenerateLayers(*batch[b], filter, tResampleEdgeMode::Clamp, chaining);
+					}
+				);
+
+				std::unique_lock<std::mutex> lock(LayerMutex);
+				LayerTaken.wait(lock, [this]() { return LayerReady.empty() || LayerCancel; });
+				for (int b = 0; b < batchCount; b++)
+					if (batch[b])
+						LayerReady.push_back(std::make_pair(order[batchStart + b], batch[b]));
+			}
+			LayerDone = true;
+		}
+	);
+}
+
+
+void Image::UpdateLayerJob()
+{
+	if (!LayerThread.joinable())
+		return;
+
+	// Layers made with mipmap settings that have since changed are thrown away and everything is bound again.
+	Config::ProfileData& profile = Config::GetProfileData();
+	if ((LayerFilter != profile.MipmapFilter) || (LayerChaining != profile.MipmapChaining))
+	{
+		CancelLayerJob();
+		Unbind();
+		return;
+	}
+
+	// Checked before taking the batch so nothing can be handed over after the last take.
+	bool done = LayerDone;
+	std::vector<std::pair<int, tList<tLayer>*>> ready;
+	{
+		const std::lock_guard<std::mutex> lock(LayerMutex);
+		ready.swap(LayerReady);
+	}
+	LayerTaken.notify_all();
+
+	// A frame unbound in the meantime just keeps its layers in the cache for the next bind.
+	for (std::pair<int, tList<tLayer>*>& item : ready)
+	{
+		tPicture* picture = FrameTable[item.first];
+		if (picture->TextureID != 0)
+			BindLayers(*item.second, picture->TextureID);
+		CacheLayers(item.first, item.second);
+	}
+	if (!ready.empty())
+		EvictLayerCache(this, FrameNum);
+
+	if (!done)
+		return;
+	LayerThread.join();
+
+	// Pending frames that were unbound again are left for the next bind. Ones cached in the meantime are complete.
+	std::vector<int> frames;
+	for (int frame : LayerPending)
+	{
+		tPicture* picture = FrameTable[frame];
+		if (picture->TextureID == 0)
+			continue;
+		tList<tLayer>* layers = GetCachedLayers(frame);
+		if (layers)
+			BindLayers(*layers, picture->TextureID);
+		else
+			frames.push_back(frame);
+	}
+	LayerPending.clear();
+	if (!frames.empty())
+		StartLayerJob(frames);
+}
+
+
+void Image::CancelLayerJob()
+{
+	if (!LayerThread.joinable())
+		return;
+
+	// Set under the lock so a worker about to wait for a batch to be taken can't miss it.
+	{
+		const std::lock_guard<std::mutex> lock(LayerMutex);
+		LayerCancel = true;
+	}
+	LayerTaken.notify_all();
+	LayerThread.join();
+
+	for (std::pair<int, tList<tLayer>*>& item : LayerReady)
+		delete item.second;
+	LayerReady.clear();
+	LayerPending.clear();
+	LayerCancel = false;
+}
+
+
+void Image::BindTopLevel(const tPicture& picture, uint texID)
+{
+	// Pictures are always RGBA. Like any single layer texture, minification is nearest.
+	glBindTexture(GL_TEXTURE_2D, texID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexImage2D
+	(
+		GL_TEXTURE_2D, 0, GL_RGBA8, picture.GetWidth(), picture.GetHeight(), 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, picture.GetPixelPointer()
+	);
+}
+
+
+void Image::UnbindFramesOutsideWindow()
+{
+	// The frame table only holds the scratch picture when delta-stored.
+	if (!DeltaFrames.empty())
+		return;
+
+	// Compressed-resident images only keep the displayed picture bound. That lets the decode cache evict the others.
+	if (!CompressedFrames.empty())
+	{
+		for (int frame = 0; frame < int(CompressedFrames.size()); frame++)
+		{
+			tPicture* pic = CompressedFrames[frame].Decoded;
+			if (pic && (pic->TextureID != 0) && (frame != FrameNum))
+			{
+				glDeleteTextures(1, &pic->TextureID);
+				pic->TextureID = 0;
+			}
+		}
+		return;
+	}
+
+	int numFrames = int(FrameTable.size());
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		tPicture* pic = FrameTable[frame];
+		if (pic->TextureID == 0)
+			continue;
+
+		// Playback may loop so the distance wraps around. Looking both ways keeps scrubbing and reverse play smooth.
+		int dist = tAbs(frame - FrameNum);
+		dist = tMin(dist, numFrames - dist);
+		if (dist > FrameBindWindow/2)
+		{
+			glDeleteTextures(1, &pic->TextureID);
+			pic->TextureID = 0;
+		}
+	}
+}
+
+
 void Image::Unbind()
 {
 	for (tPicture* pic = Pictures.First(); pic; pic = pic->Next())
@@ -1625,6 +2833,15 @@ void Image::Unbind()
 		}
 	}
 
+	for (CompressedFrame& frame : CompressedFrames)
+	{
+		if (frame.Decoded && (frame.Decoded->TextureID != 0))
+		{
+			glDeleteTextures(1, &frame.Decoded->TextureID);
+			frame.Decoded->TextureID = 0;
+		}
+	}
+
 	if (TexIDAlt != 0)
 	{
 		glDeleteTextures(1, &TexIDAlt);
@@ -1770,6 +2987,10 @@ uint64 Image::BindThumbnail()
 		ThumbnailThread.join();
 		ThumbnailThreadRunning = false;
 		ThumbnailNumThreadsRunning--;
+
+		// The worker may have read new meta-data from the cache file or the image. We're back on the main thread so
+		// it's safe to update our row in the table.
+		ImagesMetaTable.SetRow(MetaRow, Cached_MetaData);
 	}
 
 	if (ThumbnailThreadRunning)
@@ -1869,6 +3090,7 @@ void Image::GenerateThumbnail()
 	}
 
 	Image thumbLoader;
+	thumbLoader.SetCompactStorageEnabled(false);
 	int maxLoadAttempts = 5;
 	for (int attempt = 0; attempt < maxLoadAttempts; attempt++)
 	{
@@ -1910,7 +3132,7 @@ void Image::GenerateThumbnail()
 	tAssert((iw == ThumbWidth) || (ih == ThumbHeight));
 
 	// Create an image that is big (or small) enough to exactly match either the width or height without ruining the aspect.
-	srcPic->Resample(iw, ih, tResampleFilter::Bilinear);
+	Resampler::Resample(*srcPic, iw, ih, tResampleFilter::Bilinear);
 
 	// Center-crop the image to what we need. Cropping to a bigger size adds transparent pixels.
 	srcPic->Crop(ThumbWidth, ThumbHeight);
@@ -15,6 +15,10 @@
 #pragma once
 #include <thread>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include <functional>
 #include <glad/glad.h>
 #include <Foundation/tList.h>
 #include <Foundation/tString.h>
@@ -43,6 +47,7 @@
 #include <Image/tImageHDR.h>
 #include <Image/tImageKTX.h>
 #include "Config.h"
+#include "GifPalette.h"
 #include "Undo.h"
 namespace tImage { class tLayer; }
 namespace Viewer
@@ -85,7 +90,23 @@ public:
 
 	bool Load(const tString& filename, bool loadParamsFromConfig = true);
 	bool Load(bool loadParamsFromConfig = true);																		// Load into main memory.
-	bool IsLoaded() const																								{ return (Pictures.Count() > 0); }
+
+	// Reloads with the current load parameters. This is what the properties window calls while load parameters are
+	// being edited. The file contents are read once and kept until the next regular Unload so each reload only redoes
+	// the decode. The decode runs on a worker thread and the current pictures stay displayed until Bind picks up the
+	// result. Does nothing if the image is dirty.
+	void Reload();
+	bool IsReloading() const																							{ return ReloadThread.joinable(); }
+
+	// Returns a new unloaded image of the same file with the same load parameters. A worker thread may load the copy
+	// without touching this image, which the main thread may be drawing. The caller owns the returned image.
+	Image* CreateLoadCopy() const;
+
+	// Replaces any pictures with the supplied frames without going through a file. The frames list is emptied. Since
+	// the pictures don't match anything on disk, the image is left dirty so it will not be unloaded. The raw import
+	// preview uses this so parameter tweaks do not need a save and reload.
+	void Set(tList<tImage::tFrame>& frames);
+	bool IsLoaded() const																								{ return (Pictures.Count() > 0) || !CompressedFrames.empty(); }
 
 	// These are structs used for specifying parameters when saving. Different image types support different
 	// features and therefore each needs a unique set of parameters. When calling Save you can optionally ask for these
@@ -100,6 +121,7 @@ public:
 	tImage::tImageTGA::SaveParams  SaveParamsTGA;
 	tImage::tImageTIFF::SaveParams SaveParamsTIFF;
 	tImage::tImageWEBP::SaveParams SaveParamsWEBP;
+	GifPalette::Mode SaveParamsGIFPalette = GifPalette::Mode::PerFrame;
 
 	// Not all fileTypes are supported for save. Handles single and multi-frame images. If useConfigSaveParams is true
 	// any paramteres used for saving that are stored in the viewer config file will override the setting in the save
@@ -108,8 +130,8 @@ public:
 	// defined by FrameNum will be saved. Returns success.
 	bool Save(const tString& outFile, tSystem::tFileType fileType, bool useConfigSaveParams = true, bool onlyCurrentPic = false) const;
 
-	int GetNumFrames() const																							{ return Pictures.Count(); }
-	int GetNumPictures() const																							{ return Pictures.Count(); }
+	int GetNumFrames() const;
+	int GetNumPictures() const																							{ return GetNumFrames(); }
 
 	bool IsOpaque() const;
 	bool Unload(bool force = false);
@@ -128,11 +150,42 @@ public:
 
 	// Some images can store multiple complete images inside a single file (multiple frames).
 	// The primary one is the first one.
-	tImage::tPicture* GetPrimaryPic() const																				{ return Pictures.First(); }
-	tImage::tPicture* GetFirstPic() const																				{ return Pictures.First(); }
-	tImage::tPicture* GetCurrentPic() const																				{ tImage::tPicture* pic = Pictures.First(); for (int i = 0; i < FrameNum; i++) pic = pic ? pic->Next() : nullptr; return pic; }
+	tImage::tPicture* GetPrimaryPic() const																				{ return GetPic(0); }
+	tImage::tPicture* GetFirstPic() const																				{ return GetPic(0); }
+	tImage::tPicture* GetCurrentPic() const																				{ return GetPic(tMath::tClampMin(FrameNum, 0)); }
+
+	// Random access to any frame. This is O(1) since it uses the frame table that is kept in sync with the Pictures
+	// list. Returns nullptr if frameNum is out of range. If the frames are delta-stored (see below) the returned
+	// picture is a shared scratch picture that is only valid until GetPic is called again for a different frame. If
+	// compressed-resident, a later GetPic may evict a decoded picture returned earlier, so only the primary (frame 0)
+	// and current frame pictures may be held across GetPic calls. Those two are never evicted, though the current one
+	// may be once FrameNum changes. Any edit invalidates all returned pictures.
+	tImage::tPicture* GetPic(int frameNum) const;
+
+	// When delta-stored this list only contains the scratch picture. Use GetNumFrames and GetPic to visit all frames.
 	const tList<tImage::tPicture>& GetPictures() const																	{ return Pictures; }
 
+	// Animated images whose frames only change in small regions (screen recordings, UI captures) may be kept in memory
+	// as dirty-rect deltas against the previous frame. This is decided on load if the DeltaFrameStorage config option
+	// is on and the deltas are small enough to be worth it. Any edit expands the frames back to full pictures first.
+	bool IsDeltaStored() const																							{ return !DeltaFrames.empty(); }
+
+	// Block-compressed DDS, KTX, PVR, and ASTC files may keep their compressed layers as the resident representation
+	// if the KeepTexturesCompressed config option is on. Individual mipmaps or cubemap faces are decoded to RGBA only
+	// when GetPic asks for them, and the decoded pictures are kept in a small bounded cache. As with delta-stored
+	// frames, any edit decodes everything first.
+	bool IsCompressedResident() const																					{ return !CompressedFrames.empty(); }
+
+	// Delta storage and compressed residency are both turned off for loads that are only going to be used once, like
+	// thumbnail generation.
+	void SetCompactStorageEnabled(bool enabled)																			{ CompactStorageEnabled = enabled; }
+
+	// For edits that run on a worker thread against a copy. CopyPictures appends a full copy of every frame (delta or
+	// compressed storage is not expanded in place). SetPictures pushes an undo step, takes all the pictures from the
+	// list, and sets the dirty flag.
+	void CopyPictures(tList<tImage::tPicture>&) const;
+	void SetPictures(tList<tImage::tPicture>&, const tString& desc);
+
 	// Functions that edit and cause dirty flag to be set. Functions that return a bool will return false if the image
 	// is unmodified and the dirty flag is untouched. Functions that are void should be assumed to modify the image.
 	void Rotate90(bool antiClockWise);
@@ -143,6 +196,9 @@ public:
 	// desireable as the computed or fixed palette would not be used.
 	void QuantizeFixed(int numColours, bool checkExact = true);
 
+	// The next three use the library quantizers. They go one picture at a time while holding the quantize lock (see
+	// GetQuantizeMutex) so any other thread quantizing at the same time, like a save, waits its turn.
+	//
 	// Similar to above but uses spatial quantization to generate the palette. If ditherLevel is 0.0 it will compute a
 	// good dither amount for you based on the image dimensions and number of colours. Filter size must be 1, 3, or 5.
 	void QuantizeSpatial(int numColours, bool checkExact = true, double ditherLevel = 0.0, int filterSize = 3);
@@ -181,7 +237,11 @@ public:
 	bool Paste(int regionW, int regionH, const tColour4b* regionPixels, int originX, int originY, comp_t channels = tCompBit_RGBA);
 	bool Paste(int regionW, int regionH, const tColour4b* regionPixels, tImage::tPicture::Anchor, comp_t channels = tCompBit_RGBA);
 	bool Deborder(const tColour4b& borderColour, comp_t channels = tCompBit_RGBA);
-	bool Resample(int newWidth, int newHeight, tImage::tResampleFilter filter, tImage::tResampleEdgeMode edgeMode);
+
+	// A box filter with integer reduction ratios uses a fast area average. gammaCorrect makes that average happen in
+	// linear light. It has no effect on other filters.
+	bool Resample(int newWidth, int newHeight, tImage::tResampleFilter filter, tImage::tResampleEdgeMode edgeMode, bool gammaCorrect = false);
+
 	void SetPixelColour(int x, int y, const tColour4b&, bool pushUndo, bool supressDirty = false);
 	void SetAllPixels(const tColour4b& colour, comp_t channels = tCompBit_RGBA);
 
@@ -213,8 +273,8 @@ public:
 	void SetFrameDuration(float duration, bool allFrames = false);
 
 	// Undo and redo functions.
-	void Undo()																											{ UndoStack.Undo(Pictures, Dirty); }
-	void Redo()																											{ UndoStack.Redo(Pictures, Dirty); }
+	void Undo()																											{ ExpandFrames(); ClearLayerCache(); UndoStack.Undo(Pictures, Dirty); RebuildFrameTable(); }
+	void Redo()																											{ ExpandFrames(); ClearLayerCache(); UndoStack.Redo(Pictures, Dirty); RebuildFrameTable(); }
 	bool IsUndoAvailable() const																						{ return UndoStack.UndoAvailable(); }
 	bool IsRedoAvailable() const																						{ return UndoStack.RedoAvailable(); }
 	tString GetUndoDesc() const																							{ tString desc; tsPrintf(desc, "[%s]", UndoStack.GetUndoDesc().Chr()); return desc; }
@@ -240,7 +300,8 @@ public:
 
 	bool IsAltMipmapsPictureAvail() const																				{ return (AltPictureTyp == AltPictureType::MipmapSideBySide); }
 	bool IsAltCubemapPictureAvail() const																				{ return (AltPictureTyp == AltPictureType::CubemapTLayout); }
-	void EnableAltPicture(bool enabled)																					{ AltPictureEnabled = enabled; }
+	// The alt picture is only built the first time it is enabled and is freed again when disabled.
+	void EnableAltPicture(bool enabled);
 	bool IsAltPictureEnabled() const																					{ return AltPictureEnabled; }
 
 	// Thumbnail generation is done on a seperate thread. Calling RequestThumbnail starts the thread. You should call it
@@ -273,6 +334,10 @@ public:
 	int Cached_PrimaryArea		= 0;
 	tImage::tMetaData Cached_MetaData;
 
+	// The row in the ImagesMetaTable holding the numeric values of Cached_MetaData. Assigned on the main thread when
+	// the image is first sorted. -1 means no row, in which case the table returns defaults.
+	int MetaRow					= -1;
+
 	const static uint32 ThumbChunkInfoID;
 	const static uint32 ThumbChunkMetaDataID;
 	const static uint32 ThumbChunkMetaDatumID;
@@ -292,7 +357,7 @@ public:
 
 private:
 	bool UndoEnabled = true;
-	void PushUndo(const tString& desc)																					{ if (UndoEnabled) UndoStack.Push(Pictures, desc, Dirty); }
+	void PushUndo(const tString& desc)																					{ ExpandFrames(); ClearLayerCache(); if (UndoEnabled) UndoStack.Push(Pictures, desc, Dirty); }
 	void PopUndo()																										{ if (UndoEnabled) UndoStack.Pop(); }
 
 	// There are multiple pictures for a few reasons. Images with multiple frames (gifs, exrs, tiffs, webps etc) store
@@ -300,6 +365,72 @@ private:
 	// in the picture list, and dds files may contain mipmaps, also stored in the list.
 	tList<tImage::tPicture> Pictures;
 
+	// An index of the pictures in the Pictures list so any frame may be accessed in constant time. Playback, the frame
+	// scrubber, and extracting or saving individual frames all go through GetPic/GetCurrentPic. This must be rebuilt
+	// whenever the list itself (not the picture contents) changes.
+	std::vector<tImage::tPicture*> FrameTable;
+	void RebuildFrameTable();
+
+	// Calls func once for every picture in the Pictures list with the pictures spread across threads. func may only
+	// modify the picture it is given. Used by the edits that treat every frame independently. frameWorkBytes is the
+	// temporary memory func needs for one picture. The thread count is limited so that all frames being processed at
+	// once stay under ParallelEditMaxBytes. If frameWorkBytes is 0, twice the largest picture's size is assumed.
+	static const int64 ParallelEditMaxBytes = 1024*1024*1024;
+	void ForEachPicture(const std::function<void(tImage::tPicture*)>& func, int64 frameWorkBytes = 0);
+
+	// Delta frame storage. Frame 0 and every DeltaKeyframeInterval'th frame are keyframes holding the whole picture so
+	// random access never has to replay more than a handful of deltas. Other frames hold only the rectangle that
+	// changed since the previous frame (which may be empty). While in use, Pictures holds a single scratch picture that
+	// GetPic materializes the requested frame into. Sequential playback only applies one delta per frame.
+	struct DeltaFrame
+	{
+		bool Keyframe			= false;
+		int X					= 0;
+		int Y					= 0;
+		int W					= 0;
+		int H					= 0;
+		float Duration			= 0.0f;
+		std::vector<tColour4b> Pixels;
+	};
+	static const int DeltaKeyframeInterval = 32;
+	bool CompactStorageEnabled = true;
+	std::vector<DeltaFrame> DeltaFrames;
+	mutable int DeltaScratchFrame = -1;					// The frame currently materialized in the scratch picture.
+	int DeltaBoundFrame = -1;							// The frame the scratch picture's texture was created from.
+
+	// Converts the Pictures list to deltas. Returns false and leaves the pictures alone if the frames differ in size or
+	// the deltas would not save at least half the memory.
+	bool CompactDeltaFrames();
+	void ExpandDeltaFrames();
+	void MaterializeDeltaFrame(int frameNum) const;
+
+	// Compressed residency. Each frame keeps its block-compressed layer in file row order. Decoding flips the rows so
+	// the picture matches what a regular load produces. The cache holds decoded pictures until they add up to more
+	// than DecodedCacheMaxBytes, always keeping the most recently used one, the primary and current frames, and any
+	// that are bound to a texture.
+	struct CompressedFrame
+	{
+		tImage::tLayer* Layer		= nullptr;		// Owned.
+		tImage::tPicture* Decoded	= nullptr;		// Owned. Null when not in the cache.
+		uint64 LastUse				= 0;
+	};
+	static const int64 DecodedCacheMaxBytes = 256*1024*1024;
+	mutable std::vector<CompressedFrame> CompressedFrames;
+	mutable uint64 CompressedUseCount = 0;
+
+	// Returns true if the loader's layers could all be kept compressed. On false nothing is kept and a regular load
+	// with decoding should be done instead.
+	template<typename ImageType> bool LoadCompressedResident(typename ImageType::LoadParams);
+	bool PopulateCompressedFrames(const tImage::tBaseImage&);
+	bool IsCompressedResidentFormat(tImage::tPixelFormat) const;
+	void DecodeCompressedFrame(int frameNum) const;
+	void EvictDecodedFrames(int keepFrame) const;
+	void ExpandCompressedFrames();
+	void ClearCompressedFrames();
+
+	// Expands delta-stored or compressed-resident frames so the Pictures list holds every frame as a full picture.
+	void ExpandFrames()																									{ ExpandDeltaFrames(); ExpandCompressedFrames(); }
+
 	// The 'alternative' picture is valid when there is another valid way of displaying the image.
 	// Specifically for cubemaps and dds files with mipmaps this offers an alternative view.
 	bool AltPictureEnabled = false;
@@ -330,19 +461,105 @@ private:
 
 	// Returns the approx main mem size of this image. Considers the Pictures list and the AltPicture.
 	int GetMemSizeBytes() const;
+	void UpdateOpacityInfo();
 
-	// This function can handle DDS, PVR, and KTX images and populate the pictures list as well as create the
-	// alternate image if necessary.
+	// This function can handle DDS, PVR, and KTX images and populate the pictures list as well as set which alternate
+	// picture type is available. The alt picture is built from the Pictures by the MultiSurfaceCreateAlt functions.
 	void MultiSurfacePopulatePictures(const tImage::tBaseImage&);
-	void MultiSurfaceCreateAltCubemapPicture(const teList<tImage::tLayer> layers[tImage::tFaceIndex::tFaceIndex_NumFaces]);
-	void MultiSurfaceCreateAltMipmapPicture(const teList<tImage::tLayer>&);
+	void MultiSurfaceCreateAltCubemapPicture();
+	void MultiSurfaceCreateAltMipmapPicture();
+
+	// Images with more pictures than this (long animations) only keep this many frames around the current one bound
+	// to textures. Images with fewer (mipmaps, cubemaps, short animations) bind everything at once.
+	static const int FrameBindWindow = 32;
+	void BindFrame(int frameNum);
+	void UnbindFramesOutsideWindow();
+
+	// Generated mipmap layers are kept per frame after they are uploaded so a rebind (frames re-entering the bind
+	// window, the delta scratch picture moving on, reloading textures after Unbind) does not generate them again.
+	// Entries remember the filter and chaining they were made with and are ignored if those preferences change. The
+	// whole cache is dropped whenever picture pixels change. LayerCacheMaxBytes is a single budget shared by every
+	// image. Once the total goes over it the least recently used entries of any image are freed. The cached bytes
+	// count towards the owning image's memory size. The cache is only touched from the main thread. Images loaded on
+	// worker threads (thumbnails, task snapshots) are never bound so they never use it.
+	struct LayerCacheEntry
+	{
+		tList<tImage::tLayer>* Layers	= nullptr;		// Owned. Null if the frame has no cached layers.
+		int Filter						= 0;
+		bool Chaining					= false;
+		int64 NumBytes					= 0;
+		uint64 LastUse					= 0;
+	};
+	static const int64 LayerCacheMaxBytes = 512*1024*1024;
+	static int64 LayerCacheTotalBytes;
+	static uint64 LayerCacheUseCount;
+	static std::vector<Image*> LayerCacheImages;		// Images that may have cached entries.
+	std::vector<LayerCacheEntry> LayerCache;
+	int64 LayerCacheBytes = 0;
+	tList<tImage::tLayer>* GetCachedLayers(int frameNum);
+	void CacheLayers(int frameNum, tList<tImage::tLayer>*);
+	void FreeCachedLayers(int frameNum);
+	void AddLayerCacheBytes(int64 numBytes);
+	static void EvictLayerCache(const Image* keepImage, int keepFrame);
+	void ClearLayerCache();
+
+	// Images bound all at once have their mipmaps generated on a worker so the first draw isn't held up. Until a
+	// frame's layers arrive it is drawn from a texture holding only its top level. The worker hands the layers over
+	// a batch at a time and waits for each batch to be taken, so at most two batches are alive outside the cache.
+	// The worker reads the pictures' pixels. Anything that changes or frees them must call CancelLayerJob first,
+	// which ClearLayerCache and FreeLoaded do.
+	std::thread LayerThread;
+	std::atomic<bool> LayerDone		{ false };
+	std::atomic<bool> LayerCancel	{ false };
+	std::mutex LayerMutex;
+	std::condition_variable LayerTaken;
+	std::vector<std::pair<int, tList<tImage::tLayer>*>> LayerReady;		// Frame and layers. Guarded by LayerMutex.
+	std::vector<int> LayerPending;					// Frames bound while the worker was busy. Main thread only.
+	int LayerFilter					= 0;
+	bool LayerChaining				= false;
+	void StartLayerJob(const std::vector<int>& frames);
+	void UpdateLayerJob();
+	void CancelLayerJob();
+	void BindTopLevel(const tImage::tPicture&, uint texID);
 
 	void GetGLFormatInfo(GLint& srcFormat, GLenum& srcType, GLint& dstFormat, bool& compressed, tImage::tPixelFormat);
 	void BindLayers(const tList<tImage::tLayer>&, uint texID);
 
+	// The file contents kept for reloads. Only the DDS, PVR, KTX, ASTC, PKM, and HDR loaders can decode from memory,
+	// so FetchFileData does nothing for other types and those reloads read the file again.
+	uint8* FileData = nullptr;
+	int FileDataSize = 0;
+	std::time_t FileDataModTime = 0;
+	bool FetchFileData();
+	void ReleaseFileData();
+	template<typename ImageType> bool LoadImageType(ImageType&, const typename ImageType::LoadParams&);
+
+	// Returns false if loadingFiletype is an animation (GIF, WEBP, or APNG) whose frames, fully decoded, would take
+	// more than the MaxImageMemMB budget. Only the headers are read. Other types always return true.
+	bool CheckAnimationFitsBudget(tSystem::tFileType loadingFiletype) const;
+
+	// The worker decodes into a separate unbound image. Its pictures are moved into this one on the main thread.
+	std::thread ReloadThread;
+	std::atomic<bool> ReloadDone { false };
+	bool ReloadPending = false;						// Parameters changed again while the worker was busy.
+	Image* ReloadResult = nullptr;
+	void UpdateReload();
+	void CancelReload();
+	void TakeLoaded(Image&);
+
+	// Frees everything populated by a load. Does not check the dirty flag.
+	void FreeLoaded();
+
 	float LoadedTime = -1.0f;
 	bool Dirty = false;
 
+	// Beginning an adjustment snapshots a picture and builds its histograms. AdjustmentBegin only does this for the
+	// current picture since that's the one being previewed. The others are begun, in parallel, the first time an
+	// adjustment is applied to all frames. AdjustPicture is null when no adjustment is in progress.
+	tImage::tPicture* AdjustPicture = nullptr;
+	bool AdjustAllBegun = false;
+	void AdjustBeginAll();
+
 	// Undo / Redo
 	Undo::Stack UndoStack;
 };
@@ -12,6 +12,7 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <vector>
 #include <Math/tVector2.h>
 #include <Math/tColour.h>
 #include <System/tFile.h>
@@ -34,6 +35,7 @@
 #include "FileDialog.h"
 #include "TacentView.h"
 #include "Image.h"
+#include "Parallel.h"
 using namespace tMath;
 using namespace tFileDialog;
 using namespace tImage;
@@ -44,13 +46,7 @@ namespace ImportRaw
 	FileDialog SelectFileDialog(DialogMode::OpenFile);
 	tString ImportedDstFile;
 
-	enum class CreateResult
-	{
-		Success,
-		UnsupportedFormat,
-		DataShortage,
-		DecodeError
-	};
+	// Reads the raw file (through the cache) and decodes it.
 	CreateResult CreateFrames
 	(
 		tList<tFrame>& frames, const tString& rawFile, tImage::tPixelFormat rawFmt,
@@ -58,8 +54,49 @@ namespace ImportRaw
 		bool mipmaps, bool mipmapForceSameFrameSize, int surfaceOrMipmapCount,
 		bool undoAlphaPremult, tColourSpace, bool reverseRows
 	);
+
+	// Each level (mipmap or surface) of a raw import. The decoded pixels are either LDR or HDR, never both.
+	struct Level
+	{
+		int Width					= 0;
+		int Height					= 0;
+		int DataOffset				= 0;
+		int NumBytes				= 0;
+		tPixel4b* PixelsLDR			= nullptr;
+		tPixel4f* PixelsHDR			= nullptr;
+		tImage::DecodeResult Result	= tImage::DecodeResult::Success;
+		tFrame* Frame				= nullptr;
+	};
+
+	// A range of rows of one level.
+	struct Band
+	{
+		int LevelIndex;
+		int StartRow;
+		int EndRow;
+	};
+
+	// Converts rows [startRow, endRow) of the decoded level into its frame. The table maps alpha*256 + channel to the
+	// output channel value and may be null if no conversion is needed.
+	void ConvertRows(Level&, int startRow, int endRow, const uint8* table, bool reverseRows);
+
 	tString MakeImportedFilename(tSystem::tFileType destType, const tString& rawFile);
 	bool CreateImportedFile(tList<tFrame>& frames, const tString& filename);
+	bool CreateImportedFile(const Viewer::Image&, const tString& filename);
+
+	// The raw file is read once and kept while the dialog is open so live updates only need to decode. It is read
+	// again if a different file is chosen, the file changes on disk, or the parameters need more bytes than were read.
+	// The returned data is owned by the cache.
+	tString RawCacheFile;
+	std::time_t RawCacheModTime = 0;
+	uint8* RawCacheData = nullptr;
+	int RawCacheSize = 0;
+	uint8* GetRawFileHead(const tString& rawFile, int numBytes);
+	void FreeRawCache();
+
+	// The imported image only exists in memory until OK is pressed. Discarding it repopulates the images so the
+	// in-memory image is dropped from the list.
+	void DiscardPreview();
 }
 
 
@@ -164,13 +201,8 @@ bool Viewer::ShowImportRawOverlay(bool* popen, bool justOpened)
 		{
 			dstType = newType;
 
-			// If it changed and an existing file exists, delete it and clear the ImportedDstFile.
-			if (ImportRaw::ImportedDstFile.IsValid())
-			{
-				bool deleted = DeleteImageFile(ImportRaw::ImportedDstFile, false);
-				if (deleted)
-					ImportRaw::ImportedDstFile.Clear();
-			}
+			// If it changed the current preview has the wrong type. The next import creates a new one.
+			ImportRaw::DiscardPreview();
 		}
 		ImGui::SameLine();
 		Gutil::HelpMark
@@ -291,8 +323,9 @@ bool Viewer::ShowImportRawOverlay(bool* popen, bool justOpened)
 		ImGui::SameLine();
 		Gutil::HelpMark
 		(
-			"Automatically re-import on any change. This can be slow as the entire raw\n"
-			"input file is read, parsed, decoded, saved, and re-bound for display."
+			"Automatically re-import on any change. The raw file is only read once. Each\n"
+			"change decodes the pixels again and re-binds them for display. The imported\n"
+			"file is not written until OK is pressed."
 		);
 
 		Gutil::Separator();
@@ -357,19 +390,22 @@ bool Viewer::ShowImportRawOverlay(bool* popen, bool justOpened)
 
 		if (ImGui::Button("Reset", tVector2(buttonWidth, 0.0f)))
 		{
-			if (ImportRaw::ImportedDstFile.IsValid())
-				DeleteImageFile(ImportRaw::ImportedDstFile, false);
-			ImportRaw::ImportedDstFile.Clear();
+			ImportRaw::DiscardPreview();
+			ImportRaw::FreeRawCache();
 			Config::ResetProfile(Config::Category_ImportRaw);
 			surfaceOrMipmapCount = 1;
 			importResultMessage.Clear();
 		}
 
+		// The images get repopulated if the directory contents change. That drops the in-memory preview so it is
+		// imported again from the cached raw data.
+		bool previewLost = ImportRaw::ImportedDstFile.IsValid() && !FindImage(ImportRaw::ImportedDstFile);
+
 		if (profile.ImportRawFilename.IsValid())
 		{
 			ImGui::SameLine();
 			ImGui::SetCursorPosX(rightButtons);
-			if (Gutil::Button("Import", tVector2(buttonWidth, 0.0f)) || liveUpdated)
+			if (Gutil::Button("Import", tVector2(buttonWidth, 0.0f)) || liveUpdated || previewLost)
 			{
 				importResultMessage = "Success";
 				tList<tFrame> frames;
@@ -391,25 +427,18 @@ bool Viewer::ShowImportRawOverlay(bool* popen, bool justOpened)
 					}
 					else
 					{
-						bool exists = ImportRaw::CreateImportedFile(frames, dstFilename);
-						if (exists)
-						{
-							// We only set ImportedDstFile once we know it exists.
-							ImportRaw::ImportedDstFile = dstFilename;
-							bool found = SetCurrentImage(ImportRaw::ImportedDstFile, true);
-							if (!found)
-							{
-								Image* newImg = new Image(ImportRaw::ImportedDstFile);
-								Images.Append(newImg);
-								ImagesLoadTimeSorted.Append(newImg);
-								SortImages(profile.GetSortKey(), profile.SortAscending);
-								SetCurrentImage(dstFilename);
-							}
-						}
-						else
+						// The frames go straight into the displayed image. Nothing is written until OK is pressed.
+						ImportRaw::ImportedDstFile = dstFilename;
+						Image* img = FindImage(dstFilename);
+						if (!img)
 						{
-							importResultMessage = "File Write Failure";
+							img = new Image(dstFilename);
+							Images.Append(img);
+							ImagesLoadTimeSorted.Append(img);
+							SortImages(profile.GetSortKey(), profile.SortAscending);
 						}
+						img->Set(frames);
+						SetCurrentImage(dstFilename);
 					}
 				}
 				else
@@ -420,18 +449,18 @@ bool Viewer::ShowImportRawOverlay(bool* popen, bool justOpened)
 						case ImportRaw::CreateResult::DataShortage:			importResultMessage = "Data Shortage";		break;
 						case ImportRaw::CreateResult::DecodeError:			importResultMessage = "Decode Error";		break;
 					}
+
+					// Don't keep trying to restore a lost preview every frame.
+					if (previewLost)
+						ImportRaw::ImportedDstFile.Clear();
 				}
 			}
 		}
 
 		if (ImGui::Button("Cancel", tVector2(buttonWidth, 0.0f)))
 		{
-			if (ImportRaw::ImportedDstFile.IsValid())
-			{
-				bool deleted = DeleteImageFile(ImportRaw::ImportedDstFile, false);
-				if (deleted)
-					ImportRaw::ImportedDstFile.Clear();
-			}
+			ImportRaw::DiscardPreview();
+			ImportRaw::FreeRawCache();
 			*popen = false;
 			handledClose = true;
 		}
@@ -440,9 +469,26 @@ bool Viewer::ShowImportRawOverlay(bool* popen, bool justOpened)
 		ImGui::SetCursorPosX(rightButtons);
 		if (ImGui::Button("OK", tVector2(buttonWidth, 0.0f)))
 		{
-			ImportRaw::ImportedDstFile.Clear();
-			*popen = false;
-			handledClose = true;
+			// This is where the imported file is actually written. It is made from the displayed pictures so what
+			// is saved is exactly what was previewed.
+			bool written = true;
+			Image* img = ImportRaw::ImportedDstFile.IsValid() ? FindImage(ImportRaw::ImportedDstFile) : nullptr;
+			if (img)
+			{
+				written = ImportRaw::CreateImportedFile(*img, ImportRaw::ImportedDstFile);
+				if (written)
+					img->ClearDirty();
+				else
+					importResultMessage = "File Write Failure";
+			}
+
+			if (written)
+			{
+				ImportRaw::ImportedDstFile.Clear();
+				ImportRaw::FreeRawCache();
+				*popen = false;
+				handledClose = true;
+			}
 		}
 	}
 
@@ -453,34 +499,75 @@ bool Viewer::ShowImportRawOverlay(bool* popen, bool justOpened)
 
 void Viewer::CloseCancelImportRawOverlay()
 {
-	if (ImportRaw::ImportedDstFile.IsValid())
+	ImportRaw::DiscardPreview();
+	ImportRaw::FreeRawCache();
+}
+
+
+void ImportRaw::DiscardPreview()
+{
+	if (ImportedDstFile.IsEmpty())
+		return;
+
+	// If the preview is being displayed we move to a neighbouring image, just like when a file is deleted.
+	Viewer::Image* img = Viewer::CurrImage;
+	tString nextImgFile;
+	if (img)
 	{
-		bool deleted = DeleteImageFile(ImportRaw::ImportedDstFile, false);
-		if (deleted)
-			ImportRaw::ImportedDstFile.Clear();
+		nextImgFile = img->Filename;
+		if (img->Filename == ImportedDstFile)
+			nextImgFile = img->Next() ? img->Next()->Filename : (img->Prev() ? img->Prev()->Filename : tString());
 	}
+	ImportedDstFile.Clear();
+
+	Viewer::ImageToLoad = nextImgFile;
+	Viewer::PopulateImages();
+	Viewer::SetCurrentImage(nextImgFile);
 }
 
 
-ImportRaw::CreateResult ImportRaw::CreateFrames
-(
-	tList<tFrame>& frames, const tString& rawFile, tImage::tPixelFormat rawFmt,
-	int width, int height, int offset,
-	bool mipmaps, bool mipmapForceSameFrameSize, int surfaceOrMipmapCount,
-	bool undoAlphaPremult, tColourSpace space, bool reverseRows
-)
+uint8* ImportRaw::GetRawFileHead(const tString& rawFile, int numBytes)
 {
-	if (rawFile.IsEmpty() || !tSystem::tFileExists(rawFile))
-		return ImportRaw::CreateResult::DataShortage;
+	tSystem::tFileInfo info;
+	if (!tSystem::tGetFileInfo(info, rawFile))
+		return nullptr;
+
+	bool stale = (RawCacheFile != rawFile) || (RawCacheModTime != info.ModificationTime) || (RawCacheSize < numBytes);
+	if (!stale)
+		return RawCacheData;
+
+	FreeRawCache();
+	int numReadBytes = numBytes;
+	uint8* data = tSystem::tLoadFileHead(rawFile, numReadBytes);
+	if (numReadBytes != numBytes)
+	{
+		delete[] data;
+		return nullptr;
+	}
 
-	if ((width <= 0) || (height <= 0) || (offset < 0))
-		return ImportRaw::CreateResult::DecodeError;
+	RawCacheFile		= rawFile;
+	RawCacheModTime		= info.ModificationTime;
+	RawCacheData		= data;
+	RawCacheSize		= numBytes;
+	return RawCacheData;
+}
+
+
+void ImportRaw::FreeRawCache()
+{
+	delete[] RawCacheData;
+	RawCacheData = nullptr;
+	RawCacheSize = 0;
+	RawCacheModTime = 0;
+	RawCacheFile.Clear();
+}
 
-	// How much data do we have to work with?
-	int fileSize = tSystem::tGetFileSize(rawFile);
-	int dataHave = fileSize - offset;
 
-	// How much data do we need?
+int ImportRaw::GetRawDataSize(tPixelFormat rawFmt, int width, int height, bool mipmaps, int surfaceOrMipmapCount)
+{
+	if ((width <= 0) || (height <= 0))
+		return 0;
+
 	int blockW = tGetBlockWidth(rawFmt);		// These return 1 for packed.
 	int blockH = tGetBlockHeight(rawFmt);
 	int bytesPerBlock = tGetBytesPerBlock(rawFmt);
@@ -498,138 +585,234 @@ ImportRaw::CreateResult ImportRaw::CreateFrames
 		dataNeeded += blocksNeededW * blocksNeededH * bytesPerBlock;
 	}
 
-	// Do we have enough?
+	return dataNeeded;
+}
+
+
+ImportRaw::CreateResult ImportRaw::CreateFrames
+(
+	tList<tFrame>& frames, const tString& rawFile, tImage::tPixelFormat rawFmt,
+	int width, int height, int offset,
+	bool mipmaps, bool mipmapForceSameFrameSize, int surfaceOrMipmapCount,
+	bool undoAlphaPremult, tColourSpace space, bool reverseRows
+)
+{
+	if (rawFile.IsEmpty() || !tSystem::tFileExists(rawFile))
+		return ImportRaw::CreateResult::DataShortage;
+
+	if ((width <= 0) || (height <= 0) || (offset < 0))
+		return ImportRaw::CreateResult::DecodeError;
+
+	// How much data do we have to work with and how much do we need?
+	int fileSize = tSystem::tGetFileSize(rawFile);
+	int dataHave = fileSize - offset;
+	int dataNeeded = GetRawDataSize(rawFmt, width, height, mipmaps, surfaceOrMipmapCount);
 	if (dataHave < dataNeeded)
 		return ImportRaw::CreateResult::DataShortage;
 
-	// Get the raw data. We only need to read as much as we need.
-	int numReadBytes = dataNeeded+offset;
-	uint8* rawDataStart = tSystem::tLoadFileHead(rawFile, numReadBytes);
-	if (numReadBytes != dataNeeded+offset)
-	{
-		delete[] rawDataStart;
+	// Get the raw data. We only need to read as much as we need. The cache owns the memory.
+	uint8* rawDataStart = GetRawFileHead(rawFile, dataNeeded+offset);
+	if (!rawDataStart)
+		return ImportRaw::CreateResult::DataShortage;
+
+	return CreateFrames
+	(
+		frames, rawDataStart + offset, dataNeeded, rawFmt,
+		width, height,
+		mipmaps, mipmapForceSameFrameSize, surfaceOrMipmapCount,
+		undoAlphaPremult, space, reverseRows
+	);
+}
+
+
+ImportRaw::CreateResult ImportRaw::CreateFrames
+(
+	tList<tFrame>& frames, const uint8* rawPixelData, int rawDataSize, tImage::tPixelFormat rawFmt,
+	int width, int height,
+	bool mipmaps, bool mipmapForceSameFrameSize, int surfaceOrMipmapCount,
+	bool undoAlphaPremult, tColourSpace space, bool reverseRows
+)
+{
+	if ((width <= 0) || (height <= 0) || !rawPixelData)
+		return ImportRaw::CreateResult::DecodeError;
+
+	if (rawDataSize < GetRawDataSize(rawFmt, width, height, mipmaps, surfaceOrMipmapCount))
 		return ImportRaw::CreateResult::DataShortage;
-	}
 
-	uint8* rawPixelData = rawDataStart + offset;
+	int blockW = tGetBlockWidth(rawFmt);
+	int blockH = tGetBlockHeight(rawFmt);
+	int bytesPerBlock = tGetBytesPerBlock(rawFmt);
+	int numLevels = surfaceOrMipmapCount;
+	int maxLevels = mipmaps ? tImage::tGetNumMipmapLevels(width, height) : 128;
+	tMath::tiClamp(numLevels, 1, maxLevels);
 
+	// Work out where the data for each level starts so they can all be decoded at the same time.
+	std::vector<Level> levels(numLevels);
 	int levW = width; int levH = height;
+	int dataOffset = 0;
 	for (int lev = 0; lev < numLevels; lev++)
 	{
-		int blocksW = tGetNumBlocks(blockW, levW);
-		int blocksH = tGetNumBlocks(blockH, levH);
-		int numBytes = blocksW * blocksH * bytesPerBlock;
-
-		tPixel4b* pixelsLDR = nullptr;
-		tPixel4f* pixelsHDR = nullptr;
-		tImage::DecodeResult result = DecodePixelData
-		(
-			rawFmt, rawPixelData, numBytes, levW, levH,
-			pixelsLDR, pixelsHDR
-		);
+		Level& level		= levels[lev];
+		level.Width			= levW;
+		level.Height		= levH;
+		level.DataOffset	= dataOffset;
+		level.NumBytes		= tGetNumBlocks(blockW, levW) * tGetNumBlocks(blockH, levH) * bytesPerBlock;
+		dataOffset += level.NumBytes;
 
-		if (result != tImage::DecodeResult::Success)
-		{
-			delete[] rawDataStart;
-			delete[] pixelsLDR;
-			delete[] pixelsHDR;
-		}
+		if (mipmaps)
+			tImage::tGetNextMipmapLevelDims(levW, levH);
+	}
 
-		switch (result)
+	Parallel::For
+	(
+		numLevels,
+		[&](int lev)
 		{
-			case tImage::DecodeResult::Success:
-				break;
-			case tImage::DecodeResult::BuffersNotClear:
-			case tImage::DecodeResult::InvalidInput:
-				return ImportRaw::CreateResult::DataShortage;
-			case tImage::DecodeResult::UnsupportedFormat:
-				return ImportRaw::CreateResult::UnsupportedFormat;
-			case tImage::DecodeResult::PackedDecodeError:
-			case tImage::DecodeResult::BlockDecodeError:
-			case tImage::DecodeResult::ASTCDecodeError:
-			case tImage::DecodeResult::PVRDecodeError:
-			default:
-				return ImportRaw::CreateResult::DecodeError;
+			Level& level = levels[lev];
+			level.Result = DecodePixelData
+			(
+				rawFmt, rawPixelData + level.DataOffset, level.NumBytes, level.Width, level.Height,
+				level.PixelsLDR, level.PixelsHDR
+			);
 		}
+	);
 
-		// At this point either pixelsHDR or pixelsLDR will be valid (but not both).
-		tAssert((pixelsLDR || pixelsHDR) && (!pixelsLDR || !pixelsHDR));
+	tImage::DecodeResult result = tImage::DecodeResult::Success;
+	for (int lev = 0; (lev < numLevels) && (result == tImage::DecodeResult::Success); lev++)
+		result = levels[lev].Result;
 
-		// Since the internal representation of data in the viewer is tPixel4b (32-bit) we convert here if necessary.
-		if (!pixelsLDR)
+	if (result != tImage::DecodeResult::Success)
+	{
+		for (Level& level : levels)
 		{
-			pixelsLDR = new tPixel4b[levW*levH];
-			for (int p = 0; p < levW*levH; p++)
-				pixelsLDR[p].Set(pixelsHDR[p]);
-			delete[] pixelsHDR;
-			pixelsHDR = nullptr;
+			delete[] level.PixelsLDR;
+			delete[] level.PixelsHDR;
 		}
+	}
 
-		tFrame* frame = new tFrame;
-		if (mipmaps && mipmapForceSameFrameSize)
-		{
-			tPixel4b* pixels = new tPixel4b[width*height];
-			for (int p = 0; p < width*height; p++)
-				pixels[p] = tPixel4b::black;
-			frame->StealFrom(pixels, width, height);
-
-			for (int y = 0; y < levH; y++)
-				for (int x = 0; x < levW; x++)
-					frame->SetPixel(x, y, pixelsLDR[y*levW + x]);
-			delete[] pixelsLDR;
-		}
-		else
-		{
-			frame->StealFrom(pixelsLDR, levW, levH);
-		}
+	switch (result)
+	{
+		case tImage::DecodeResult::Success:
+			break;
+		case tImage::DecodeResult::BuffersNotClear:
+		case tImage::DecodeResult::InvalidInput:
+			return ImportRaw::CreateResult::DataShortage;
+		case tImage::DecodeResult::UnsupportedFormat:
+			return ImportRaw::CreateResult::UnsupportedFormat;
+		case tImage::DecodeResult::PackedDecodeError:
+		case tImage::DecodeResult::BlockDecodeError:
+		case tImage::DecodeResult::ASTCDecodeError:
+		case tImage::DecodeResult::PVRDecodeError:
+		default:
+			return ImportRaw::CreateResult::DecodeError;
+	}
 
-		// Possibly undo alpha premultiplication by multiplying by the colour channels
-		// by the inverse of the alpha.
-		if (undoAlphaPremult || (space == tColourSpace::lRGB))
+	// Undoing alpha premultiplication and converting from linear only depend on the 8-bit channel value and alpha,
+	// so the whole conversion is baked into a table indexed by both. Entries are computed exactly as a per-pixel
+	// conversion through tColour4f would be, so results are identical while the per-pixel cost is a lookup.
+	std::vector<uint8> convertTable;
+	if (undoAlphaPremult || (space == tColourSpace::lRGB))
+	{
+		convertTable.resize(256*256);
+		for (int a = 0; a < 256; a++)
 		{
-			for (int p = 0; p < frame->Width*frame->Height; p++)
+			for (int v = 0; v < 256; v++)
 			{
-				tColour4b col = frame->Pixels[p];
+				tColour4b col(uint8(v), uint8(v), uint8(v), uint8(a));
 				tColour4f colf(col);
 				if (undoAlphaPremult)
 				{
 					float invAlpha = (colf.A > 0.0f) ? 1.0f/colf.A : 1.0f;
 					colf.R *= invAlpha;
-					colf.G *= invAlpha;
-					colf.B *= invAlpha;
 				}
 				if (space == tColourSpace::lRGB)
-				{
-					colf.LinearToSRGB(tCompBit_RGB);
-				}
+					colf.LinearToSRGB(tCompBit_R);
 				col.Set(colf);
-				frame->Pixels[p] = col;
+				convertTable[a*256 + v] = col.R;
 			}
 		}
+	}
+
+	// Create the frames. When the mipmaps are forced to the same size the unused area is opaque black.
+	for (Level& level : levels)
+	{
+		bool padded = mipmaps && mipmapForceSameFrameSize;
+		int frameW = padded ? width  : level.Width;
+		int frameH = padded ? height : level.Height;
+		tPixel4b* pixels = new tPixel4b[frameW*frameH];
+		if (padded)
+			for (int p = 0; p < frameW*frameH; p++)
+				pixels[p] = tPixel4b::black;
+
+		level.Frame = new tFrame;
+		level.Frame->StealFrom(pixels, frameW, frameH);
+
+		// Matches the frame duration CreateImportedFile saves with.
+		level.Frame->Duration = 1.0f;
+	}
 
-		// Possibly reverse the row order.
-		if (reverseRows)
+	// A single pass converts HDR to LDR, applies the table, and writes each row straight to its (possibly reversed)
+	// destination. The work is split into bands of rows across all levels so small mipmaps don't hold anything up.
+	const int bandRows = 64;
+	std::vector<Band> bands;
+	for (int lev = 0; lev < numLevels; lev++)
+		for (int row = 0; row < levels[lev].Height; row += bandRows)
+			bands.push_back({ lev, row, tMin(row + bandRows, levels[lev].Height) });
+
+	const uint8* table = convertTable.empty() ? nullptr : convertTable.data();
+	Parallel::For
+	(
+		int(bands.size()),
+		[&](int b)
 		{
-			uint8* reversed = tImage::CreateReversedRowData((uint8*)frame->Pixels, tPixelFormat::R8G8B8A8, frame->Width, frame->Height);
-			if (reversed)
-			{
-				delete[] frame->Pixels;
-				frame->Pixels = (tColour4b*)reversed;
-			}
+			const Band& band = bands[b];
+			ConvertRows(levels[band.LevelIndex], band.StartRow, band.EndRow, table, reverseRows);
 		}
+	);
 
-		frames.Append(frame);
-
-		if (mipmaps)
-			tImage::tGetNextMipmapLevelDims(levW, levH);
-		rawPixelData += numBytes;
+	for (Level& level : levels)
+	{
+		delete[] level.PixelsLDR;
+		delete[] level.PixelsHDR;
+		frames.Append(level.Frame);
 	}
 
-	delete[] rawDataStart;
 	return ImportRaw::CreateResult::Success;
 }
 
 
+void ImportRaw::ConvertRows(Level& level, int startRow, int endRow, const uint8* table, bool reverseRows)
+{
+	tFrame* frame = level.Frame;
+	for (int y = startRow; y < endRow; y++)
+	{
+		int dstY = reverseRows ? (frame->Height - 1 - y) : y;
+		tPixel4b* dst = frame->Pixels + dstY*frame->Width;
+		const tPixel4b* srcLDR = level.PixelsLDR ? level.PixelsLDR + y*level.Width : nullptr;
+		const tPixel4f* srcHDR = level.PixelsHDR ? level.PixelsHDR + y*level.Width : nullptr;
+
+		for (int x = 0; x < level.Width; x++)
+		{
+			// Either the LDR or HDR pixels are valid, but not both.
+			tPixel4b col;
+			if (srcLDR)
+				col = srcLDR[x];
+			else
+				col.Set(srcHDR[x]);
+
+			if (table)
+			{
+				const uint8* entry = table + col.A*256;
+				col.R = entry[col.R];
+				col.G = entry[col.G];
+				col.B = entry[col.B];
+			}
+			dst[x] = col;
+		}
+	}
+}
+
+
 tString ImportRaw::MakeImportedFilename(tSystem::tFileType destType, const tString& rawFile)
 {
 	tString dir = tSystem::tGetDir(rawFile);
@@ -653,6 +836,24 @@ tString ImportRaw::MakeImportedFilename(tSystem::tFileType destType, const tStri
 }
 
 
+bool ImportRaw::CreateImportedFile(const Viewer::Image& img, const tString& filename)
+{
+	tList<tFrame> frames;
+	int numFrames = img.GetNumFrames();
+	for (int f = 0; f < numFrames; f++)
+	{
+		const tPicture* picture = img.GetPic(f);
+		if (!picture || !picture->IsValid())
+			return false;
+
+		// This tFrame constructor copies the pixels.
+		frames.Append(new tFrame(picture->GetPixelPointer(), picture->GetWidth(), picture->GetHeight(), picture->Duration));
+	}
+
+	return CreateImportedFile(frames, filename);
+}
+
+
 bool ImportRaw::CreateImportedFile(tList<tFrame>& frames, const tString& filename)
 {
 	// OverWrite the file if necessary.
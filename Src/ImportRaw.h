@@ -13,6 +13,11 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #pragma once
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+#include <Math/tColour.h>
+#include <Image/tPixelFormat.h>
+#include <Image/tFrame.h>
 
 
 namespace Viewer
@@ -25,4 +30,26 @@ namespace Viewer
 namespace ImportRaw
 {
 	extern tString ImportedDstFile;
+
+	enum class CreateResult
+	{
+		Success,
+		UnsupportedFormat,
+		DataShortage,
+		DecodeError
+	};
+
+	// Returns how many bytes of raw data a single image with the supplied dimensions and number of surfaces or
+	// mipmaps takes. The count is clamped the same way CreateFrames clamps it.
+	int GetRawDataSize(tImage::tPixelFormat, int width, int height, bool mipmaps, int surfaceOrMipmapCount);
+
+	// Decodes raw pixel data that is already in memory into one frame per surface or mipmap. The data must start at
+	// the first pixel (any header already skipped). This is thread-safe so many raw files may be imported at once.
+	CreateResult CreateFrames
+	(
+		tList<tImage::tFrame>& frames, const uint8* rawData, int rawDataSize, tImage::tPixelFormat rawFmt,
+		int width, int height,
+		bool mipmaps, bool mipmapForceSameFrameSize, int surfaceOrMipmapCount,
+		bool undoAlphaPremult, tColourSpace, bool reverseRows
+	);
 }
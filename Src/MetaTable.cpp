@@ -0,0 +1,130 @@
+// MetaTable.cpp
+//
+// A compact structure-of-arrays store for the cached meta-data values used to sort images. There is one contiguous
+// column of floats per meta-data tag so sorting or filtering a large folder is a linear scan instead of a walk through
+// every image's full tMetaData.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include "MetaTable.h"
+using namespace tImage;
+
+
+namespace Viewer
+{
+	MetaTable ImagesMetaTable;
+
+	struct ColumnInfo
+	{
+		Config::ProfileData::SortKeyEnum SortKey;
+		tMetaTag Tag;
+		bool IsUint32;				// Some tags store their value in the Uint32 member rather than the Float.
+		float Default;
+	};
+
+	// Must be in the same order as the Column enum.
+	const ColumnInfo ColumnInfos[] =
+	{
+		{ Config::ProfileData::SortKeyEnum::MetaLatitude,		tMetaTag::LatitudeDD,		false,	-100.0f		},
+		{ Config::ProfileData::SortKeyEnum::MetaLongitude,		tMetaTag::LongitudeDD,		false,	-200.0f		},
+		{ Config::ProfileData::SortKeyEnum::MetaAltitude,		tMetaTag::Altitude,			false,	-1000.0f	},
+		{ Config::ProfileData::SortKeyEnum::MetaRoll,			tMetaTag::Roll,				false,	0.0f		},
+		{ Config::ProfileData::SortKeyEnum::MetaPitch,			tMetaTag::Pitch,			false,	0.0f		},
+		{ Config::ProfileData::SortKeyEnum::MetaYaw,			tMetaTag::Yaw,				false,	0.0f		},
+		{ Config::ProfileData::SortKeyEnum::MetaSpeed,			tMetaTag::Speed,			false,	0.0f		},
+
+		// Camera Shutter 'Speed' is measured in 1/s. 125 => 1/125th second. 0.0 (infinite) is the default.
+		{ Config::ProfileData::SortKeyEnum::MetaShutterSpeed,	tMetaTag::ShutterSpeed,		false,	0.0f		},
+
+		// Exposure time is how long the shutter is open for. Basically the inverse of the shutter speed.
+		{ Config::ProfileData::SortKeyEnum::MetaExposureTime,	tMetaTag::ExposureTime,		false,	0.0f		},
+
+		// No existing lens can get down to an f-stop of 0.5. That's why we use 0.5 as the default.
+		{ Config::ProfileData::SortKeyEnum::MetaFStop,			tMetaTag::FStop,			false,	0.5f		},
+
+		// ISO as low as 25 exist. 100-200 is 'normal' speed film. 400 is fast (but grainy).
+		{ Config::ProfileData::SortKeyEnum::MetaISO,			tMetaTag::ISO,				false,	0.0f		},
+
+		// Aperture in APEX units can't get down to 0.
+		{ Config::ProfileData::SortKeyEnum::MetaAperture,		tMetaTag::Aperture,			false,	0.0f		},
+
+		// All non-90-degree transforms are grouped at the start. All 90-degree transforms have larger values. The
+		// default 0 means 'unspecified'. The small integer values are represented exactly as floats.
+		{ Config::ProfileData::SortKeyEnum::MetaOrientation,	tMetaTag::Orientation,		true,	0.0f		},
+
+		// Brightness in APEX Bv units. 0 is dark -- about 3.4candelas/(m^2).
+		{ Config::ProfileData::SortKeyEnum::MetaBrightness,		tMetaTag::Brightness,		false,	0.0f		},
+
+		// Flash used is 0 for not used, 1 for used.
+		{ Config::ProfileData::SortKeyEnum::MetaFlash,			tMetaTag::FlashUsed,		true,	0.0f		},
+
+		// Focal length in mm. 0 means unknown.
+		{ Config::ProfileData::SortKeyEnum::MetaFocalLength,	tMetaTag::FocalLength,		false,	0.0f		}
+	};
+	tStaticAssert(tNumElements(ColumnInfos) == int(MetaTable::Column::NumColumns));
+}
+
+
+Viewer::MetaTable::Column Viewer::MetaTable::GetColumn(Config::ProfileData::SortKeyEnum key)
+{
+	for (int c = 0; c < int(Column::NumColumns); c++)
+		if (ColumnInfos[c].SortKey == key)
+			return Column(c);
+
+	return Column::Invalid;
+}
+
+
+float Viewer::MetaTable::GetDefault(Column col)
+{
+	if ((col <= Column::Invalid) || (col >= Column::NumColumns))
+		return 0.0f;
+
+	return ColumnInfos[int(col)].Default;
+}
+
+
+void Viewer::MetaTable::Clear()
+{
+	for (int c = 0; c < int(Column::NumColumns); c++)
+		Columns[c].clear();
+	NumRows = 0;
+}
+
+
+int Viewer::MetaTable::AddRow()
+{
+	for (int c = 0; c < int(Column::NumColumns); c++)
+		Columns[c].push_back(ColumnInfos[c].Default);
+
+	return NumRows++;
+}
+
+
+void Viewer::MetaTable::SetRow(int row, const tMetaData& metaData)
+{
+	if ((row < 0) || (row >= NumRows))
+		return;
+
+	bool valid = metaData.IsValid();
+	for (int c = 0; c < int(Column::NumColumns); c++)
+	{
+		const ColumnInfo& info = ColumnInfos[c];
+		float value = info.Default;
+		if (valid)
+		{
+			const tMetaDatum& datum = metaData[info.Tag];
+			if (datum.IsSet())
+				value = info.IsUint32 ? float(datum.Uint32) : datum.Float;
+		}
+		Columns[c][row] = value;
+	}
+}
@@ -0,0 +1,80 @@
+// MetaTable.h
+//
+// A compact structure-of-arrays store for the cached meta-data values used to sort images. There is one contiguous
+// column of floats per meta-data tag so sorting or filtering a large folder is a linear scan instead of a walk through
+// every image's full tMetaData.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <vector>
+#include <Image/tMetaData.h>
+#include "Config.h"
+namespace Viewer
+{
+
+
+class MetaTable
+{
+public:
+	// One column for every numeric meta-data tag that may be sorted on. String tags like the time taken or the camera
+	// make are not stored here -- they are still read from the Cached_MetaData of each image.
+	enum class Column
+	{
+		Invalid = -1,
+		Latitude,
+		Longitude,
+		Altitude,
+		Roll,
+		Pitch,
+		Yaw,
+		Speed,
+		ShutterSpeed,
+		ExposureTime,
+		FStop,
+		ISO,
+		Aperture,
+		Orientation,
+		Brightness,
+		Flash,
+		FocalLength,
+		NumColumns
+	};
+
+	// Returns Column::Invalid if the sort key is not backed by a column in this table.
+	static Column GetColumn(Config::ProfileData::SortKeyEnum);
+
+	// The value used for a row when its image has no meta-data or the tag is not set. These are chosen to sort before
+	// any real value.
+	static float GetDefault(Column);
+
+	void Clear();
+	int AddRow();																										// Returns the new row index. All values start at their defaults.
+	int GetNumRows() const																								{ return NumRows; }
+
+	// Reads every tag that has a column. Unset tags are stored as the column default.
+	void SetRow(int row, const tImage::tMetaData&);
+
+	// An invalid row (like -1 for an image that never got one) returns the default.
+	float Get(int row, Column col) const																				{ return ((row >= 0) && (row < NumRows)) ? Columns[int(col)][row] : GetDefault(col); }
+	const float* GetColumnData(Column col) const																		{ return Columns[int(col)].data(); }
+
+private:
+	int NumRows = 0;
+	std::vector<float> Columns[int(Column::NumColumns)];
+};
+
+
+// There is one table for the Images list. Rows are only ever added or set from the main thread.
+extern MetaTable ImagesMetaTable;
+
+
+}
@@ -23,8 +23,12 @@
 #include "OpenSaveDialogs.h"
 #include "TacentView.h"
 #include "Image.h"
+#include "GifPalette.h"
 #include "GuiUtil.h"
 #include "Config.h"
+#include "Quantize.h"
+#include "Resampler.h"
+#include "Task.h"
 using namespace tStd;
 using namespace tMath;
 using namespace tSystem;
@@ -238,85 +242,118 @@ void Viewer::DoSaveMultiFrameModal(bool saveMultiFramePressed)
 
 void Viewer::SaveMultiFrameTo(const tString& outFile, int outWidth, int outHeight)
 {
-	Config::ProfileData& profile = Config::GetProfileData();
-	tList<tFrame> frames;
+	// Loading and resampling every image and encoding the result all happen in a task. Images that are already loaded
+	// have their current picture copied now and the rest are loaded privately by the task.
+	std::vector<Task::ImageSnapshot*>* snapshots = new std::vector<Task::ImageSnapshot*>;
 	for (Image* img = Images.First(); img; img = img->Next())
-	{
-		if (!img->IsLoaded())
-			img->Load();
+		snapshots->push_back(new Task::ImageSnapshot(*img));
+	bool* success = new bool(false);
 
-		if (!img->IsLoaded())
-			continue;
+	bool started = Task::Start
+	(
+		"Saving Multi-Frame Image",
+		[=](Task::Context& context)
+		{
+			Config::ProfileData& profile = Config::GetProfileData();
+			tList<tFrame> frames;
+			int numImages = int(snapshots->size());
+			for (int i = 0; i < numImages; i++)
+			{
+				if (context.IsCancelled())
+					return;
 
-		tImage::tPicture* currPic = img->GetCurrentPic();
-		if (!currPic)
-			continue;
+				Task::ImageSnapshot*& snapshot = (*snapshots)[i];
+				tImage::tPicture* currPic = snapshot->GetPicture();
+				if (currPic)
+				{
+					// The picture belongs to the snapshot so it is resampled in place and its pixels given to the frame.
+					if ((currPic->GetWidth() != outWidth) || (currPic->GetHeight() != outHeight))
+						Resampler::Resample(*currPic, outWidth, outHeight, tImage::tResampleFilter(profile.ResampleFilter), tImage::tResampleEdgeMode(profile.ResampleEdgeMode));
 
-		tImage::tPicture resampled(*currPic);
-		if ((resampled.GetWidth() != outWidth) || (resampled.GetHeight() != outHeight))
-			resampled.Resample(outWidth, outHeight, tImage::tResampleFilter(profile.ResampleFilter), tImage::tResampleEdgeMode(profile.ResampleEdgeMode));
+					float duration = currPic->Duration;
+					tFrame* frame = new tFrame(currPic->StealPixels(), outWidth, outHeight, duration);
+					frames.Append(frame);
+				}
 
-		tFrame* frame = new tFrame(resampled.StealPixels(), outWidth, outHeight, currPic->Duration);
-		frames.Append(frame);
-	}
+				// The encode below can't report progress so gathering the frames counts for most of the bar.
+				delete snapshot;
+				snapshot = nullptr;
+				context.SetProgress(0.9f * float(i+1) / float(numImages));
+			}
 
-	bool success = false;
-	tFileType fileType = tGetFileTypeFromName( profile.SaveFileTypeMultiFrame );
-	switch (fileType)
-	{
-		case tFileType::GIF:
-		{
-			tImageGIF gif(frames, true);
-			tImageGIF::SaveParams params;
-			params.Format					= tPixelFormat(int(tPixelFormat::FirstPalette) + profile.SaveFileGifBPP - 1);
-			params.Method					= tQuantize::Method(profile.SaveFileGifQuantMethod);
-			params.Loop						= profile.SaveFileGifLoop;
-			params.AlphaThreshold			= profile.SaveFileGifAlphaThreshold;
-			params.OverrideFrameDuration	= profile.SaveFileGifDurMultiFrame;
-			params.DitherLevel				= double(profile.SaveFileGifDitherLevel);
-			params.FilterSize				= (profile.SaveFileGifFilterSize * 2) + 1;
-			params.SampleFactor				= profile.SaveFileGifSampleFactor;
-			success = gif.Save(outFile, params);
-			break;
-		}
+			tFileType fileType = tGetFileTypeFromName( profile.SaveFileTypeMultiFrame );
+			switch (fileType)
+			{
+				case tFileType::GIF:
+				{
+					tImageGIF::SaveParams params;
+					params.Format					= tPixelFormat(int(tPixelFormat::FirstPalette) + profile.SaveFileGifBPP - 1);
+					params.Method					= tQuantize::Method(profile.SaveFileGifQuantMethod);
+					params.Loop						= profile.SaveFileGifLoop;
+					params.AlphaThreshold			= profile.SaveFileGifAlphaThreshold;
+					params.OverrideFrameDuration	= profile.SaveFileGifDurMultiFrame;
+					params.DitherLevel				= double(profile.SaveFileGifDitherLevel);
+					params.FilterSize				= (profile.SaveFileGifFilterSize * 2) + 1;
+					params.SampleFactor				= profile.SaveFileGifSampleFactor;
+					const std::lock_guard<std::mutex> lock(GetQuantizeMutex());
+					GifPalette::Apply(frames, GifPalette::Mode(profile.SaveFileGifPaletteMode), params);
+					tImageGIF gif(frames, true);
+					*success = gif.Save(outFile, params);
+					break;
+				}
 
-		case tFileType::WEBP:
-		{
-			tImageWEBP webp(frames, true);
-			success = webp.Save(outFile, profile.SaveFileWebpLossy, profile.SaveFileWebpQualComp, profile.SaveFileWebpDurMultiFrame);
-			break;
-		}
+				case tFileType::WEBP:
+				{
+					tImageWEBP webp(frames, true);
+					*success = webp.Save(outFile, profile.SaveFileWebpLossy, profile.SaveFileWebpQualComp, profile.SaveFileWebpDurMultiFrame);
+					break;
+				}
 
-		case tFileType::APNG:
-		{
-			tImageAPNG apng(frames, true);
-			tImageAPNG::SaveParams params;
-			params.OverrideFrameDuration = profile.SaveFileApngDurMultiFrame;
-			tImageAPNG::tFormat savedFormat = apng.Save(outFile, params);
-			success = (savedFormat != tImageAPNG::tFormat::Invalid);
-			break;
-		}
+				case tFileType::APNG:
+				{
+					tImageAPNG apng(frames, true);
+					tImageAPNG::SaveParams params;
+					params.OverrideFrameDuration = profile.SaveFileApngDurMultiFrame;
+					tImageAPNG::tFormat savedFormat = apng.Save(outFile, params);
+					*success = (savedFormat != tImageAPNG::tFormat::Invalid);
+					break;
+				}
 
-		case tFileType::TIFF:
+				case tFileType::TIFF:
+				{
+					tImageTIFF tiff(frames, true);
+					tImageTIFF::SaveParams params;
+					params.UseZLibCompression = profile.SaveFileTiffZLibDeflate;
+					params.OverrideFrameDuration = profile.SaveFileTiffDurMultiFrame;
+					*success = tiff.Save(outFile, params);
+					break;
+				}
+			}
+		},
+		[=](bool cancelled)
 		{
-			tImageTIFF tiff(frames, true);
-			tImageTIFF::SaveParams params;
-			params.UseZLibCompression = profile.SaveFileTiffZLibDeflate;
-			params.OverrideFrameDuration = profile.SaveFileTiffDurMultiFrame;
-			success = tiff.Save(outFile, params);
-			break;
+			// If we saved to the same dir we are currently viewing, reload
+			// and set the current image to the generated one.
+			if (*success && ImagesDir.IsEqualCI( tGetDir(outFile) ))
+			{
+				Images.Clear();
+				PopulateImages();
+				SetCurrentImage(outFile);
+			}
+
+			for (Task::ImageSnapshot* snapshot : *snapshots)
+				delete snapshot;
+			delete snapshots;
+			delete success;
 		}
-	}
-	if (!success)
-		return;
+	);
 
-	// If we saved to the same dir we are currently viewing, reload
-	// and set the current image to the generated one.
-	if (ImagesDir.IsEqualCI( tGetDir(outFile) ))
+	if (!started)
 	{
-		Images.Clear();
-		PopulateImages();
-		SetCurrentImage(outFile);
+		for (Task::ImageSnapshot* snapshot : *snapshots)
+			delete snapshot;
+		delete snapshots;
+		delete success;
 	}
 }
 
@@ -333,12 +370,13 @@ tString Viewer::GetFrameFilename(int frameNum, const tString& dir, const tString
 void Viewer::SaveExtractedFrames(const tString& destDir, const tString& baseName, tFileType fileType, tIntervalSet frameSet)
 {
 	tAssert(CurrImage);
-	int frameNum = 0;
-	for (tImage::tPicture* framePic = CurrImage->GetFirstPic(); framePic; framePic = framePic->Next(), frameNum++)
+	int numFrames = CurrImage->GetNumFrames();
+	for (int frameNum = 0; frameNum < numFrames; frameNum++)
 	{
 		if (!frameSet.Contains(frameNum))
 			continue;
 
+		tImage::tPicture* framePic = CurrImage->GetPic(frameNum);
 		tString frameFile = GetFrameFilename(frameNum, destDir, baseName, fileType);
 		Viewer::SavePictureAs(*framePic, frameFile, fileType, false);
 	}
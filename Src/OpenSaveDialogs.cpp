@@ -12,6 +12,8 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <algorithm>
+#include <atomic>
 #include <Image/tImageTGA.h>
 #include <Image/tImagePNG.h>
 #include <Image/tImageJPG.h>
@@ -27,7 +29,11 @@
 #include "Image.h"
 #include "TacentView.h"
 #include "FileDialog.h"
+#include "GifPalette.h"
+#include "Parallel.h"
 #include "Quantize.h"
+#include "Resampler.h"
+#include "Task.h"
 using namespace tStd;
 using namespace tSystem;
 using namespace tMath;
@@ -41,9 +47,20 @@ namespace Viewer
 	void GetFilesNeedingOverwrite(const tString& destDir, tList<tStringItem>& overwriteFiles, const tString& extension);
 	void AddSavedImageIfNecessary(const tString& savedFile);
 
+	// Unloads the image for a file that was just written, or adds it to the Images list if it's new. Main thread only.
+	void UpdateSavedImage(const tString& savedFile);
+
+	// Save All keeps the decoded pictures of its concurrent jobs under this many bytes. Images whose dimensions aren't
+	// known yet are counted as this size.
+	const int64 SaveAllMaxBytes			= 1024*1024*1024;
+	const int64 SaveAllUnknownBytes		= 4096*4096*4;
+
 	// This function saves the picture to the filename specified.
 	bool SaveImageAs(Image&, const tString& outFile);
-	bool SaveResizeImageAs(Image&, const tString& outFile, int width, int height, float scale = 1.0f, Config::ProfileData::SizeModeEnum = Config::ProfileData::SizeModeEnum::SetWidthAndHeight);
+
+	// Resizes the picture in place according to the size mode and saves it. The picture's pixels are stolen by the
+	// save. Called from the Save All workers, several at once, so it must not touch the Images list.
+	bool SaveResizePictureAs(tImage::tPicture&, const tString& outFile, int width, int height, float scale = 1.0f, Config::ProfileData::SizeModeEnum = Config::ProfileData::SizeModeEnum::SetWidthAndHeight);
 	void DoSavePopup();
 	void DoSaveUnsupportedTypePopup();
 
@@ -363,6 +380,22 @@ void Viewer::DoSaveGifOptions(bool multiframeConfigValues)
 		itemWidth
 	);
 
+	ImGui::SetNextItemWidth(itemWidth);
+	ImGui::Combo("Palette", &profile.SaveFileGifPaletteMode, GifPalette::ModeNames, tNumElements(GifPalette::ModeNames));
+	ImGui::SameLine();
+	Gutil::HelpMark
+	(
+		"How palettes are shared between the frames of an animated gif.\n\n"
+		"Per Frame: Every frame gets its own palette. Best quality but the\n"
+		"palette is built again for every frame.\n\n"
+		"Global: One palette is built from a sample of all frames and used\n"
+		"for every frame. Much faster for long animations. Best when the\n"
+		"colours don't change much, like screen captures.\n\n"
+		"Adaptive: A frame reuses the previous palette unless its colours have\n"
+		"changed noticeably. A middle ground for animations with scene changes.\n\n"
+		"Global and Adaptive do not dither."
+	);
+
 	ImGui::SetNextItemWidth(itemWidth);
 	ImGui::InputInt("Alpha Threshold", &profile.SaveFileGifAlphaThreshold);
 	tiClamp(profile.SaveFileGifAlphaThreshold, -1, 255);
@@ -438,6 +471,7 @@ void Viewer::DoSaveGifOptions(bool multiframeConfigValues)
 		profile.SaveFileGifDitherLevel		= 0.0f;
 		profile.SaveFileGifFilterSize		= 1;
 		profile.SaveFileGifSampleFactor		= 1;
+		profile.SaveFileGifPaletteMode		= 0;
 		profile.SaveFileWebpDurOverride		= -1;
 		profile.SaveFileGifDurOverride		= -1;
 		profile.SaveFileGifDurMultiFrame	= 3;
@@ -666,30 +700,13 @@ bool Viewer::SaveImageAs(Image& img, const tString& outFile)
 }
 
 
-bool Viewer::SaveResizeImageAs(Image& img, const tString& outFile, int width, int height, float scale, Config::ProfileData::SizeModeEnum sizeMode)
+bool Viewer::SaveResizePictureAs(tPicture& outPic, const tString& outFile, int width, int height, float scale, Config::ProfileData::SizeModeEnum sizeMode)
 {
-	// We make sure to maintain the loaded/unloaded state. This function may be called many times in succession
-	// so we don't want them all in memory at once by indiscriminantly loading them all.
-	bool imageLoaded = img.IsLoaded();
-	if (!imageLoaded)
-		imageLoaded = img.Load();
-	if (!imageLoaded)
+	if (!outPic.IsValid())
 	{
 		tPrintf("Failed to save image %s\n", outFile.Chr());
 		return false;
-	}	
-
-	tPicture* currPic = img.GetCurrentPic();
-	if (!currPic)
-		return false;
-
-	// Make a temp copy we can safely resize.
-	tImage::tPicture outPic;
-	outPic.Set(*currPic);
-
-	// Restore loadedness.
-	if (!imageLoaded)
-		img.Unload();
+	}
 
 	int outW = outPic.GetWidth();
 	int outH = outPic.GetHeight();
@@ -724,7 +741,7 @@ bool Viewer::SaveResizeImageAs(Image& img, const tString& outFile, int width, in
 	tMath::tiClampMin(outW, 4);
 	tMath::tiClampMin(outH, 4);
 	if ((outPic.GetWidth() != outW) || (outPic.GetHeight() != outH))
-		outPic.Resample(outW, outH, tImage::tResampleFilter(profile.ResampleFilter), tImage::tResampleEdgeMode(profile.ResampleEdgeMode));
+		Resampler::Resample(outPic, outW, outH, tImage::tResampleFilter(profile.ResampleFilter), tImage::tResampleEdgeMode(profile.ResampleEdgeMode));
 
 	tFileType saveFileType = tGetFileTypeFromName(profile.SaveFileType);
 	bool success = SavePictureAs(outPic, outFile, saveFileType, true);
@@ -962,36 +979,123 @@ void Viewer::DoOverwriteMultipleFilesModal(const tList<tStringItem>& overwriteFi
 void Viewer::SaveAllImages(const tString& destDir, const tString& extension, float percent, int width, int height)
 {
 	float scale = percent/100.0f;
-	tString currFile = CurrImage ? CurrImage->Filename : tString();
 	Config::ProfileData& profile = Config::GetProfileData();
-
-	bool anySaved = false;
+	Config::ProfileData::SizeModeEnum sizeMode = profile.GetSaveAllSizeMode();
+
+	// The snapshots are taken here on the main thread. Images that aren't loaded are loaded by the task into private
+	// copies so the workers never touch the Images list. Two inputs that differ only by extension would both write
+	// the same output, so only the first of them is saved.
+	std::vector<Task::ImageSnapshot*>* snapshots = new std::vector<Task::ImageSnapshot*>;
+	std::vector<tString>* outFiles = new std::vector<tString>;
+	std::vector<int>* saved = new std::vector<int>;
 	for (Image* image = Images.First(); image; image = image->Next())
 	{
 		tString baseName = tSystem::tGetFileBaseName(image->Filename);
 		tString outFile = destDir + tString(baseName) + extension;
+		if (std::find(outFiles->begin(), outFiles->end(), outFile) != outFiles->end())
+		{
+			tPrintf("Skipping %s. Another image already saves to %s\n", image->Filename.Chr(), outFile.Chr());
+			continue;
+		}
+		snapshots->push_back(new Task::ImageSnapshot(*image));
+		outFiles->push_back(outFile);
+	}
+	saved->resize(snapshots->size(), 0);
 
-		bool ok = SaveResizeImageAs(*image, outFile, width, height, scale, profile.GetSaveAllSizeMode());
-		if (ok)
+	bool started = Task::Start
+	(
+		"Saving All",
+		[=](Task::Context& context)
 		{
-			Image* foundImage = FindImage(outFile);
-			if (foundImage)
+			// Files are spread over all cores. The budget limits how many decoded pictures are held at once. An image
+			// with unknown dimensions is assumed to be fairly large and each job needs room for its picture and
+			// about as much again for the resize or encode.
+			Task::MemoryBudget budget(SaveAllMaxBytes);
+			int numFiles = int(snapshots->size());
+			std::atomic<int> numDone { 0 };
+			Parallel::For
+			(
+				numFiles,
+				[&](int f)
+				{
+					if (context.IsCancelled())
+						return;
+
+					Task::ImageSnapshot*& snapshot = (*snapshots)[f];
+					int64 pictureBytes = snapshot->GetEstimatedBytes();
+					int64 jobBytes = 2 * ((pictureBytes > 0) ? pictureBytes : SaveAllUnknownBytes);
+					budget.Acquire(jobBytes);
+
+					const tString& outFile = (*outFiles)[f];
+					bool ok = false;
+					if (!context.IsCancelled())
+					{
+						tPicture* picture = snapshot->GetPicture();
+						if (picture)
+							ok = SaveResizePictureAs(*picture, outFile, width, height, scale, sizeMode);
+						else
+							tPrintf("Failed to save image %s\n", outFile.Chr());
+					}
+					(*saved)[f] = ok ? 1 : 0;
+
+					// Safe off the main thread. A snapshot's loader image is never bound so it has no layer cache and
+					// never touches the shared layer cache registry.
+					delete snapshot;
+					snapshot = nullptr;
+					budget.Release(jobBytes);
+
+					// The Images list is updated on the main thread as each file appears.
+					if (ok)
+						Task::Post([outFile]() { UpdateSavedImage(outFile); });
+					context.SetProgress(float(++numDone) / float(numFiles));
+				}
+			);
+		},
+		[=](bool cancelled)
+		{
+			// Files saved before a cancel are still on disk and are already in the Images list.
+			bool anySaved = std::find(saved->begin(), saved->end(), 1) != saved->end();
+
+			// If we saved to the same dir we are currently viewing we need to re-sort and set the current image again.
+			if (anySaved)
 			{
-				foundImage->Unload(true);
-				foundImage->ClearDirty();
-				foundImage->RequestInvalidateThumbnail();
+				tString currFile = CurrImage ? CurrImage->Filename : tString();
+				Config::ProfileData& profile = Config::GetProfileData();
+				SortImages(profile.GetSortKey(), profile.SortAscending);
+				SetCurrentImage(currFile);
 			}
-			else
-				AddSavedImageIfNecessary(outFile);
-			anySaved = true;
+
+			for (Task::ImageSnapshot* snapshot : *snapshots)
+				delete snapshot;
+			delete snapshots;
+			delete outFiles;
+			delete saved;
 		}
+	);
+
+	if (!started)
+	{
+		for (Task::ImageSnapshot* snapshot : *snapshots)
+			delete snapshot;
+		delete snapshots;
+		delete outFiles;
+		delete saved;
 	}
+}
+
 
-	// If we saved to the same dir we are currently viewing we need to reload and set the current image again.
-	if (anySaved)
+void Viewer::UpdateSavedImage(const tString& savedFile)
+{
+	Image* foundImage = FindImage(savedFile);
+	if (foundImage)
 	{
-		SortImages(profile.GetSortKey(), profile.SortAscending);
-		SetCurrentImage(currFile);
+		foundImage->Unload(true);
+		foundImage->ClearDirty();
+		foundImage->RequestInvalidateThumbnail();
+	}
+	else
+	{
+		AddSavedImageIfNecessary(savedFile);
 	}
 }
 
@@ -1066,13 +1170,18 @@ bool Viewer::SavePictureAs(tImage::tPicture& picture, const tString& outFile, tF
 	if (!picture.IsValid())
 		return false;
 
+	// The TGA, JPG, QOI, and BMP savers always own the pixel buffer they get. Without steal it is the picture's own
+	// buffer on loan, and StealPixels hands it back after the save, so the pixels are never copied.
+	int width = picture.GetWidth();
+	int height = picture.GetHeight();
+
 	Config::ProfileData& profile = Config::GetProfileData();
 	bool success = false;
 	switch (fileType)
 	{
 		case tFileType::TGA:
 		{
-			tImageTGA tga(picture, steal);
+			tImageTGA tga(steal ? picture.StealPixels() : picture.GetPixelPointer(), width, height, true);
 			tImageTGA::tFormat saveFormat = tImageTGA::tFormat::Auto;
 			switch (profile.SaveFileTgaDepthMode)
 			{
@@ -1080,12 +1189,15 @@ bool Viewer::SavePictureAs(tImage::tPicture& picture, const tString& outFile, tF
 				case 2: saveFormat = tImageTGA::tFormat::BPP32;		break;
 			}
 			tImageTGA::tFormat savedFmt = tga.Save(outFile, saveFormat, profile.SaveFileTgaRLE ? tImageTGA::tCompression::RLE : tImageTGA::tCompression::None);
+			if (!steal)
+				tga.StealPixels();
 			success = (savedFmt != tImageTGA::tFormat::Invalid);
 			break;
 		}
 
 		case tFileType::PNG:
 		{
+			// PNG never borrows. It may convert to 16 bit-per-component so it always gets a buffer it owns.
 			tImagePNG png(picture, steal);
 			tImagePNG::tFormat saveFormat = tImagePNG::tFormat::Auto;
 			switch (profile.SaveFilePngDepthMode)
@@ -1102,13 +1214,17 @@ bool Viewer::SavePictureAs(tImage::tPicture& picture, const tString& outFile, tF
 
 		case tFileType::JPG:
 		{
-			tImageJPG jpg(picture, steal);
+			tImageJPG jpg(steal ? picture.StealPixels() : picture.GetPixelPointer(), width, height, true);
 			success = jpg.Save(outFile, profile.SaveFileJpegQuality);
+			if (!steal)
+				jpg.StealPixels();
 			break;
 		}
 
 		case tFileType::GIF:
 		{
+			// Save All calls this from many threads at once and the GIF save runs the library quantizers.
+			const std::lock_guard<std::mutex> lock(GetQuantizeMutex());
 			tImageGIF gif(picture, steal);
 			tImageGIF::SaveParams params;
 			params.Format					= tPixelFormat(int(tPixelFormat::FirstPalette) + profile.SaveFileGifBPP - 1);
@@ -1132,7 +1248,7 @@ bool Viewer::SavePictureAs(tImage::tPicture& picture, const tString& outFile, tF
 
 		case tFileType::QOI:
 		{
-			tImageQOI qoi(picture, steal);
+			tImageQOI qoi(steal ? picture.StealPixels() : picture.GetPixelPointer(), width, height, true);
 			tImageQOI::tFormat saveFormat = tImageQOI::tFormat::Auto;
 			switch (profile.SaveFileQoiDepthMode)
 			{
@@ -1148,6 +1264,8 @@ bool Viewer::SavePictureAs(tImage::tPicture& picture, const tString& outFile, tF
 			}
 
 			tImageQOI::tFormat savedFormat = qoi.Save(outFile, saveFormat, saveProf);
+			if (!steal)
+				qoi.StealPixels();
 			success = (savedFormat != tImageQOI::tFormat::Invalid);
 			break;
 		}
@@ -1165,7 +1283,7 @@ bool Viewer::SavePictureAs(tImage::tPicture& picture, const tString& outFile, tF
 
 		case tFileType::BMP:
 		{
-			tImageBMP bmp(picture, steal);
+			tImageBMP bmp(steal ? picture.StealPixels() : picture.GetPixelPointer(), width, height, true);
 			tImageBMP::tFormat saveFormat = tImageBMP::tFormat::Auto;
 			switch (profile.SaveFileBmpDepthMode)
 			{
@@ -1173,6 +1291,8 @@ bool Viewer::SavePictureAs(tImage::tPicture& picture, const tString& outFile, tF
 				case 2: saveFormat = tImageBMP::tFormat::BPP32;		break;
 			}
 			tImageBMP::tFormat savedFormat = bmp.Save(outFile, saveFormat);
+			if (!steal)
+				bmp.StealPixels();
 			success = (savedFormat != tImageBMP::tFormat::Invalid);
 			break;
 		}
@@ -0,0 +1,349 @@
+// PaletteMap.cpp
+//
+// Fast nearest-palette-entry lookup. Colour space is split into 32x32x32 cells and each cell keeps only the palette
+// entries that could possibly be nearest to a colour inside it, so mapping a pixel usually tests a handful of entries
+// instead of the whole palette. Results are identical to a brute-force search. Benchmark checks that and times it.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <atomic>
+#include <Foundation/tFundamentals.h>
+#include <Math/tRandom.h>
+#include <System/tPrint.h>
+#include <System/tTime.h>
+#include <Image/tQuantizeFixed.h>
+#include "PaletteMap.h"
+#include "Parallel.h"
+using namespace tMath;
+
+
+namespace Viewer
+{
+	// Pixel counts below this are mapped on the calling thread.
+	const int MapPixelsPerJob = 64*1024;
+	const int MaxColourDistSq = 3*255*255;
+
+	inline int ColourDistSq(const tColour3b& a, const tColour3b& b)
+	{
+		int dr = int(a.R) - int(b.R);
+		int dg = int(a.G) - int(b.G);
+		int db = int(a.B) - int(b.B);
+		return dr*dr + dg*dg + db*db;
+	}
+
+	// Distance along one axis from v to the closest and farthest points of [lo, hi].
+	inline int AxisMinDist(int v, int lo, int hi)																		{ return (v < lo) ? (lo - v) : ((v > hi) ? (v - hi) : 0); }
+	inline int AxisMaxDist(int v, int lo, int hi)																		{ return tMax(tAbs(v - lo), tAbs(v - hi)); }
+
+	// The reference FindNearest is checked against. Tests every entry and keeps the lowest index on ties.
+	int FindNearestBruteForce(const tColour3b* palette, int numColours, const tColour3b& colour);
+
+	// Returns false if FindNearest differs from brute force for any 24-bit colour.
+	bool BenchmarkPalette(const char* name, const tColour3b* palette, int numColours, const std::vector<tColour3b>& colours);
+}
+
+
+Viewer::PaletteMap::PaletteMap(const tColour3b* palette, int numColours) :
+	Palette(palette, palette + tClamp(numColours, 1, 256))
+{
+	const int numCells = CellsPerAxis*CellsPerAxis*CellsPerAxis;
+	const int cellSize = 1 << CellShift;
+	int paletteSize = int(Palette.size());
+
+	// Any colour in a cell is at most the smallest max-distance away from some entry, so entries whose min-distance
+	// to the cell is greater than that can never be nearest. Each red slab of cells is built independently.
+	std::vector<std::vector<uint8>> slabCandidates(CellsPerAxis);
+	std::vector<std::vector<int>> slabCounts(CellsPerAxis);
+	Parallel::For
+	(
+		CellsPerAxis,
+		[&](int r)
+		{
+			std::vector<uint8>& candidates = slabCandidates[r];
+			std::vector<int>& counts = slabCounts[r];
+			counts.resize(CellsPerAxis*CellsPerAxis);
+			std::vector<int> minDists(paletteSize);
+			int rlo = r*cellSize; int rhi = rlo + cellSize - 1;
+			for (int g = 0; g < CellsPerAxis; g++)
+			{
+				int glo = g*cellSize; int ghi = glo + cellSize - 1;
+				for (int b = 0; b < CellsPerAxis; b++)
+				{
+					int blo = b*cellSize; int bhi = blo + cellSize - 1;
+					int bound = MaxColourDistSq;
+					for (int p = 0; p < paletteSize; p++)
+					{
+						const tColour3b& c = Palette[p];
+						int dr = AxisMinDist(c.R, rlo, rhi);
+						int dg = AxisMinDist(c.G, glo, ghi);
+						int db = AxisMinDist(c.B, blo, bhi);
+						minDists[p] = dr*dr + dg*dg + db*db;
+
+						int mr = AxisMaxDist(c.R, rlo, rhi);
+						int mg = AxisMaxDist(c.G, glo, ghi);
+						int mb = AxisMaxDist(c.B, blo, bhi);
+						bound = tMin(bound, mr*mr + mg*mg + mb*mb);
+					}
+
+					int count = 0;
+					for (int p = 0; p < paletteSize; p++)
+					{
+						if (minDists[p] <= bound)
+						{
+							candidates.push_back(uint8(p));
+							count++;
+						}
+					}
+					counts[g*CellsPerAxis + b] = count;
+				}
+			}
+		}
+	);
+
+	CellStart.resize(numCells + 1);
+	int start = 0;
+	for (int r = 0; r < CellsPerAxis; r++)
+	{
+		for (int c = 0; c < CellsPerAxis*CellsPerAxis; c++)
+		{
+			CellStart[r*CellsPerAxis*CellsPerAxis + c] = start;
+			start += slabCounts[r][c];
+		}
+	}
+	CellStart[numCells] = start;
+
+	Candidates.reserve(start);
+	for (int r = 0; r < CellsPerAxis; r++)
+		Candidates.insert(Candidates.end(), slabCandidates[r].begin(), slabCandidates[r].end());
+}
+
+
+int Viewer::PaletteMap::FindNearest(const tColour3b& colour) const
+{
+	int cell = GetCell(colour);
+	const uint8* candidate = Candidates.data() + CellStart[cell];
+	const uint8* end = Candidates.data() + CellStart[cell+1];
+
+	// Candidates are in palette order so the strict compare keeps the lowest index on ties.
+	int bestIndex = *candidate;
+	int bestDist = ColourDistSq(colour, Palette[bestIndex]);
+	for (candidate++; candidate < end; candidate++)
+	{
+		int dist = ColourDistSq(colour, Palette[*candidate]);
+		if (dist < bestDist)
+		{
+			bestDist = dist;
+			bestIndex = *candidate;
+		}
+	}
+
+	return bestIndex;
+}
+
+
+void Viewer::PaletteMap::MapPixels(tColour4b* pixels, int numPixels) const
+{
+	int numJobs = (numPixels + MapPixelsPerJob - 1) / MapPixelsPerJob;
+	Parallel::For
+	(
+		numJobs,
+		[&](int job)
+		{
+			int start = job*MapPixelsPerJob;
+			int end = tMin(start + MapPixelsPerJob, numPixels);
+
+			// Neighbouring pixels are often the same colour so the last result is reused.
+			tColour3b prev(pixels[start].R, pixels[start].G, pixels[start].B);
+			int prevIndex = FindNearest(prev);
+			for (int p = start; p < end; p++)
+			{
+				tColour4b& pixel = pixels[p];
+				tColour3b colour(pixel.R, pixel.G, pixel.B);
+				if (colour != prev)
+				{
+					prev = colour;
+					prevIndex = FindNearest(colour);
+				}
+				const tColour3b& mapped = Palette[prevIndex];
+				pixel.R = mapped.R; pixel.G = mapped.G; pixel.B = mapped.B;
+			}
+		}
+	);
+}
+
+
+void Viewer::PaletteMap::MapPixels(uint8* destIndices, const tColour4b* pixels, int numPixels) const
+{
+	int numJobs = (numPixels + MapPixelsPerJob - 1) / MapPixelsPerJob;
+	Parallel::For
+	(
+		numJobs,
+		[&](int job)
+		{
+			int start = job*MapPixelsPerJob;
+			int end = tMin(start + MapPixelsPerJob, numPixels);
+			tColour3b prev(pixels[start].R, pixels[start].G, pixels[start].B);
+			int prevIndex = FindNearest(prev);
+			for (int p = start; p < end; p++)
+			{
+				tColour3b colour(pixels[p].R, pixels[p].G, pixels[p].B);
+				if (colour != prev)
+				{
+					prev = colour;
+					prevIndex = FindNearest(colour);
+				}
+				destIndices[p] = uint8(prevIndex);
+			}
+		}
+	);
+}
+
+
+bool Viewer::PaletteMap::HasAtMostColours(const tColour4b* pixels, int numPixels, int maxColours)
+{
+	// One bit for every possible RGB value. 2MB.
+	std::vector<uint32> seen(1 << 19, 0);
+	int numColours = 0;
+	for (int p = 0; p < numPixels; p++)
+	{
+		uint32 rgb = (uint32(pixels[p].R) << 16) | (uint32(pixels[p].G) << 8) | uint32(pixels[p].B);
+		uint32& word = seen[rgb >> 5];
+		uint32 bit = 1u << (rgb & 31);
+		if (word & bit)
+			continue;
+
+		word |= bit;
+		if (++numColours > maxColours)
+			return false;
+	}
+
+	return true;
+}
+
+
+void Viewer::PaletteMap::GetFixedPalette(tColour3b* palette, int numColours)
+{
+	// The quantizer needs an image so a single dummy pixel is used. With checkExact off the pixel is never inspected.
+	tImage::tPixel3b dummyPixel(0, 0, 0);
+	uint8 dummyIndex = 0;
+	tImage::tQuantizeFixed::QuantizeImage(tClamp(numColours, 2, 256), 1, 1, &dummyPixel, palette, &dummyIndex, false);
+}
+
+
+int Viewer::FindNearestBruteForce(const tColour3b* palette, int numColours, const tColour3b& colour)
+{
+	int bestIndex = 0;
+	int bestDist = ColourDistSq(colour, palette[0]);
+	for (int p = 1; p < numColours; p++)
+	{
+		int dist = ColourDistSq(colour, palette[p]);
+		if (dist < bestDist)
+		{
+			bestDist = dist;
+			bestIndex = p;
+		}
+	}
+
+	return bestIndex;
+}
+
+
+bool Viewer::BenchmarkPalette(const char* name, const tColour3b* palette, int numColours, const std::vector<tColour3b>& colours)
+{
+	double startTime = tSystem::tGetTime();
+	PaletteMap paletteMap(palette, numColours);
+	double buildTime = tSystem::tGetTime() - startTime;
+
+	// Every 24-bit colour, one red slab per job.
+	std::atomic<int> numMismatches { 0 };
+	Parallel::For
+	(
+		256,
+		[&](int r)
+		{
+			int slabMismatches = 0;
+			for (int g = 0; g < 256; g++)
+			{
+				for (int b = 0; b < 256; b++)
+				{
+					tColour3b colour(uint8(r), uint8(g), uint8(b));
+					if (paletteMap.FindNearest(colour) != FindNearestBruteForce(palette, numColours, colour))
+						slabMismatches++;
+				}
+			}
+			numMismatches += slabMismatches;
+		}
+	);
+
+	// Both are timed on this thread so the speedup is from the lookup alone. The sums keep the loops from being
+	// optimized away.
+	int numColoursMapped = int(colours.size());
+	startTime = tSystem::tGetTime();
+	int bruteSum = 0;
+	for (int c = 0; c < numColoursMapped; c++)
+		bruteSum += FindNearestBruteForce(palette, numColours, colours[c]);
+	double bruteTime = tSystem::tGetTime() - startTime;
+
+	startTime = tSystem::tGetTime();
+	int lookupSum = 0;
+	for (int c = 0; c < numColoursMapped; c++)
+		lookupSum += paletteMap.FindNearest(colours[c]);
+	double lookupTime = tSystem::tGetTime() - startTime;
+
+	float speedup = (lookupTime > 0.0) ? float(bruteTime / lookupTime) : 0.0f;
+	tPrintf
+	(
+		"PaletteMap | %-10s %3d colours  build %.3fs  brute %.3fs  lookup %.3fs  speedup %.1fx  mismatches %d%s\n",
+		name, numColours, float(buildTime), float(bruteTime), float(lookupTime), speedup, int(numMismatches),
+		(bruteSum == lookupSum) ? "" : "  (sums differ)"
+	);
+
+	return (numMismatches == 0) && (bruteSum == lookupSum);
+}
+
+
+bool Viewer::PaletteMap::Benchmark(int numPixels)
+{
+	// A fixed seed so runs are comparable.
+	tMath::tRandom::tGeneratorMersenneTwister generator(1234);
+	std::vector<tColour3b> colours(tMax(numPixels, 1));
+	for (tColour3b& colour : colours)
+	{
+		uint32 bits = generator.GetBits();
+		colour.R = uint8(bits); colour.G = uint8(bits >> 8); colour.B = uint8(bits >> 16);
+	}
+
+	bool ok = true;
+	tColour3b palette[256];
+	for (int numColours : { 2, 16, 256 })
+	{
+		for (int p = 0; p < numColours; p++)
+		{
+			uint32 bits = generator.GetBits();
+			palette[p].R = uint8(bits); palette[p].G = uint8(bits >> 8); palette[p].B = uint8(bits >> 16);
+		}
+		ok = BenchmarkPalette("random", palette, numColours, colours) && ok;
+	}
+
+	// Entries bunched near mid-grey, with some repeated, leave most cells far from the palette with many candidates.
+	for (int p = 0; p < 256; p++)
+	{
+		uint32 bits = generator.GetBits();
+		palette[p].R = uint8(112 + (bits & 31)); palette[p].G = uint8(112 + ((bits >> 8) & 31)); palette[p].B = uint8(112 + ((bits >> 16) & 31));
+	}
+	ok = BenchmarkPalette("clustered", palette, 256, colours) && ok;
+
+	GetFixedPalette(palette, 256);
+	ok = BenchmarkPalette("fixed", palette, 256, colours) && ok;
+
+	tPrintf("PaletteMap | %s\n", ok ? "All lookups match brute force." : "FAILED. Lookups differ from brute force.");
+	return ok;
+}
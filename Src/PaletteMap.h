@@ -0,0 +1,73 @@
+// PaletteMap.h
+//
+// Fast nearest-palette-entry lookup. Colour space is split into 32x32x32 cells and each cell keeps only the palette
+// entries that could possibly be nearest to a colour inside it, so mapping a pixel usually tests a handful of entries
+// instead of the whole palette. Results are identical to a brute-force search.
+//
+// This is the mapping used by the fixed quantize method and by the shared GIF palettes. The spatial, neu, and wu
+// quantizers in the image library assign pixels as part of their own algorithms (scolorq's dither depends on it) so
+// they keep their own mapping.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <vector>
+#include <Foundation/tStandard.h>
+#include <Math/tColour.h>
+namespace Viewer
+{
+
+
+class PaletteMap
+{
+public:
+	// The palette is copied. numColours must be in [1, 256]. All cells are built up front (spread across threads) so
+	// the lookups below are read-only and may be called from any number of threads.
+	PaletteMap(const tColour3b* palette, int numColours);
+
+	int GetNumColours() const																							{ return int(Palette.size()); }
+	const tColour3b& GetColour(int index) const																			{ return Palette[index]; }
+
+	// Returns the index of the palette entry with the smallest squared RGB distance. Ties go to the lowest index, just
+	// like a brute-force search.
+	int FindNearest(const tColour3b& colour) const;
+
+	// Maps every pixel to its nearest entry. The first replaces the RGB of each pixel with the palette colour and
+	// leaves alpha alone. The second writes palette indices. Large pixel counts are spread across threads.
+	void MapPixels(tColour4b* pixels, int numPixels) const;
+	void MapPixels(uint8* destIndices, const tColour4b* pixels, int numPixels) const;
+
+	// Returns true if there are no more than maxColours distinct RGB values in the pixels. Stops as soon as it knows.
+	static bool HasAtMostColours(const tColour4b* pixels, int numPixels, int maxColours);
+
+	// Gets the palette the fixed quantize method uses for numColours in [2, 256]. It does not depend on any image.
+	static void GetFixedPalette(tColour3b* palette, int numColours);
+
+	// Checks FindNearest against a brute-force search for every 24-bit colour and times both on numPixels random
+	// pixels. A few palettes are tried, random, clustered, and fixed. Prints the results and returns false if any
+	// lookup differs from brute force.
+	static bool Benchmark(int numPixels = 4*1024*1024);
+
+private:
+	static const int CellBits	= 5;
+	static const int CellsPerAxis	= 1 << CellBits;
+	static const int CellShift	= 8 - CellBits;
+	static int GetCell(const tColour3b& c)																				{ return ((c.R >> CellShift) << (2*CellBits)) | ((c.G >> CellShift) << CellBits) | (c.B >> CellShift); }
+
+	std::vector<tColour3b> Palette;
+
+	// The candidates for cell i are Candidates[CellStart[i]] to Candidates[CellStart[i+1]-1], in palette order.
+	std::vector<int> CellStart;
+	std::vector<uint8> Candidates;
+};
+
+
+}
@@ -0,0 +1,70 @@
+// Parallel.cpp
+//
+// A minimal parallel-for used to spread CPU-heavy per-picture or per-row work across cores. The calling thread takes
+// part in the work so nothing is wasted waiting, and the call only returns once every index has been processed.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <Foundation/tFundamentals.h>
+#include <System/tMachine.h>
+#include "Parallel.h"
+using namespace tSystem;
+
+
+namespace Parallel
+{
+	// True on any thread that is currently running a For func.
+	thread_local bool InsideFor = false;
+}
+
+
+int Parallel::GetNumThreads()
+{
+	return tMath::tMax(tGetNumCores(), 1);
+}
+
+
+void Parallel::For(int count, const std::function<void(int index)>& func, int maxThreads)
+{
+	if (count <= 0)
+		return;
+
+	int numThreads = (maxThreads > 0) ? tMath::tMin(maxThreads, GetNumThreads()) : GetNumThreads();
+	tMath::tiClampMax(numThreads, count);
+	if ((numThreads <= 1) || InsideFor)
+	{
+		for (int i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	std::atomic<int> nextIndex { 0 };
+	auto worker = [&]()
+	{
+		InsideFor = true;
+		for (int i = nextIndex++; i < count; i = nextIndex++)
+			func(i);
+		InsideFor = false;
+	};
+
+	// The calling thread is one of the workers.
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads-1);
+	for (int t = 0; t < numThreads-1; t++)
+		threads.push_back(std::thread(worker));
+
+	worker();
+	for (std::thread& thread : threads)
+		thread.join();
+}
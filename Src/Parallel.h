@@ -0,0 +1,30 @@
+// Parallel.h
+//
+// A minimal parallel-for used to spread CPU-heavy per-picture or per-row work across cores. The calling thread takes
+// part in the work so nothing is wasted waiting, and the call only returns once every index has been processed.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <functional>
+
+
+namespace Parallel
+{
+	// The number of threads For will use at most, including the calling thread. Always at least 1.
+	int GetNumThreads();
+
+	// Calls func(index) once for every index in [0, count). Indices are handed out one at a time so uneven work
+	// balances itself. func must be safe to call concurrently for different indices and must not touch OpenGL.
+	// maxThreads of 0 means use GetNumThreads. With a count of 1 or a single thread everything runs on the caller.
+	// A For called from inside another For's func also runs on the caller so nesting never oversubscribes the cores.
+	void For(int count, const std::function<void(int index)>& func, int maxThreads = 0);
+}
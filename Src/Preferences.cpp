@@ -373,7 +373,7 @@ void Viewer::ShowPreferencesWindow(bool* popen)
 
 			ImGui::SetNextItemWidth(itemWidth);
 			ImGui::InputInt("Max Mem (MB)", &profile.MaxImageMemMB); ImGui::SameLine();
-			Gutil::HelpMark("Approx memory use limit of this app. Minimum 256 MB.");
+			Gutil::HelpMark("Approx memory use limit of this app. Animations that would need more than this\nonce decoded are not loaded. Minimum 256 MB.");
 			tMath::tiClampMin(profile.MaxImageMemMB, 256);
 
 			ImGui::SetNextItemWidth(itemWidth);
@@ -440,6 +440,22 @@ void Viewer::ShowPreferencesWindow(bool* popen)
 			ImGui::Checkbox("Detect APNG Inside PNG", &profile.DetectAPNGInsidePNG); ImGui::SameLine();
 			Gutil::HelpMark("Some png image files are really apng files. If detecton is true these png files will be displayed animated.");
 
+			ImGui::Checkbox("Delta Frame Storage", &profile.DeltaFrameStorage); ImGui::SameLine();
+			Gutil::HelpMark
+			(
+				"Animated images whose frames only change in small regions (like screen recordings) are kept in\n"
+				"memory as the changed rectangles only. Takes effect the next time an image is loaded. Editing\n"
+				"an image expands the frames back to full size."
+			);
+
+			ImGui::Checkbox("Keep Textures Compressed", &profile.KeepTexturesCompressed); ImGui::SameLine();
+			Gutil::HelpMark
+			(
+				"Block-compressed dds, ktx, pvr, and astc files stay compressed in memory. Only the mipmap or cubemap\n"
+				"face being displayed or saved is decoded. Files that need gamma, sRGB, or exposure adjustment while\n"
+				"loading are decoded as usual. Takes effect the next time an image is loaded."
+			);
+
 			ImGui::Checkbox("Mipmap Chaining", &profile.MipmapChaining); ImGui::SameLine();
 			Gutil::HelpMark("Chaining generates mipmaps faster. No chaining gives slightly\nbetter results at cost of large generation time.");
 
@@ -0,0 +1,731 @@
+// Probe.cpp
+//
+// Header-only probing of image files. Reads just enough of each file to get the primary image dimensions (and EXIF
+// meta-data for JPGs) without decoding any pixels. This is run on background threads right after a folder is
+// populated so the cached sort keys are meaningful before any thumbnails exist. CountFrames walks the block structure
+// of animations so a load can be refused before it decodes more frames than fit in memory.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstdio>
+#include <System/tMachine.h>
+#include "Probe.h"
+#include "Image.h"
+#include "MetaTable.h"
+#include "Config.h"
+using namespace tSystem;
+using namespace tImage;
+
+
+namespace Probe
+{
+	// Most headers are tiny. JPGs are the exception since the EXIF APP1 segment (up to 64KB) and possibly an ICC
+	// profile come before the SOF marker that holds the dimensions.
+	const int HeadBytesDefault	= 4096;
+	const int HeadBytesJPG		= 160*1024;
+	const int MaxInt			= 0x7FFFFFFF;
+
+	inline uint32 ReadLE16(const uint8* p)																				{ return uint32(p[0]) | (uint32(p[1]) << 8); }
+	inline uint32 ReadBE16(const uint8* p)																				{ return (uint32(p[0]) << 8) | uint32(p[1]); }
+	inline uint32 ReadLE24(const uint8* p)																				{ return uint32(p[0]) | (uint32(p[1]) << 8) | (uint32(p[2]) << 16); }
+	inline uint32 ReadLE32(const uint8* p)																				{ return uint32(p[0]) | (uint32(p[1]) << 8) | (uint32(p[2]) << 16) | (uint32(p[3]) << 24); }
+	inline uint32 ReadBE32(const uint8* p)																				{ return (uint32(p[0]) << 24) | (uint32(p[1]) << 16) | (uint32(p[2]) << 8) | uint32(p[3]); }
+
+	bool ProbePNG	(Result&, const uint8* data, int numBytes);
+	bool ProbeJPG	(Result&, const uint8* data, int numBytes, bool exifOrient);
+	bool ProbeGIF	(Result&, const uint8* data, int numBytes);
+	bool ProbeBMP	(Result&, const uint8* data, int numBytes);
+	bool ProbeTGA	(Result&, const uint8* data, int numBytes);
+	bool ProbeQOI	(Result&, const uint8* data, int numBytes);
+	bool ProbeWEBP	(Result&, const uint8* data, int numBytes);
+	bool ProbeDDS	(Result&, const uint8* data, int numBytes);
+	bool ProbeKTX	(Result&, const uint8* data, int numBytes);
+	bool ProbePVR	(Result&, const uint8* data, int numBytes);
+	bool ProbeASTC	(Result&, const uint8* data, int numBytes);
+	bool ProbePKM	(Result&, const uint8* data, int numBytes);
+	bool ProbeHDR	(Result&, const uint8* data, int numBytes);
+
+	// Reads a file front to back a block at a time so the structure of large animations can be walked without loading
+	// the whole thing. Read returns false at the end of the file and Skip returns false if it could not seek.
+	struct FileReader
+	{
+		FileReader(const tString& filename)																				: File(tOpenFile(filename.Chr(), "rb")) { }
+		~FileReader()																									{ if (File) tCloseFile(File); }
+		bool IsValid() const																							{ return File != nullptr; }
+		bool Read(uint8* dest, int numBytes);
+		bool Skip(int64 numBytes);
+
+		tFileHandle File;
+		int64 BufferOffset	= 0;		// File offset of Buffer[0].
+		int Pos				= 0;
+		int End				= 0;
+		uint8 Buffer[64*1024];
+	};
+
+	int CountFramesGIF	(FileReader&, int maxFrames);
+	int CountFramesWEBP	(FileReader&, int maxFrames);
+	int CountFramesPNG	(FileReader&);
+
+	// Each job owns copies of everything the worker needs so the worker never touches an Image. Only the main thread
+	// dereferences Img, and only if the jobs haven't been cancelled (which must happen before the images are deleted).
+	struct Job
+	{
+		tString Filename;
+		tFileType Filetype = tFileType::Unknown;
+		Viewer::Image* Img = nullptr;
+		Result Res;
+		std::atomic<bool> Done { false };
+	};
+
+	Job* Jobs						= nullptr;
+	int NumJobs						= 0;
+	int NextToApply					= 0;
+	bool ExifOrient					= false;
+	std::atomic<int> NextJob		{ 0 };
+	std::atomic<bool> CancelRequested { false };
+	std::vector<std::thread> Workers;
+
+	void WorkerThread();
+}
+
+
+bool Probe::ProbePNG(Result& result, const uint8* data, int numBytes)
+{
+	// 8 byte signature followed by the IHDR chunk. Width and height are the first two big-endian fields of IHDR.
+	if ((numBytes < 24) || (data[0] != 0x89) || (data[1] != 'P') || (data[2] != 'N') || (data[3] != 'G'))
+		return false;
+	if ((data[12] != 'I') || (data[13] != 'H') || (data[14] != 'D') || (data[15] != 'R'))
+		return false;
+
+	result.Width	= int(ReadBE32(data + 16));
+	result.Height	= int(ReadBE32(data + 20));
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeJPG(Result& result, const uint8* data, int numBytes, bool exifOrient)
+{
+	if ((numBytes < 4) || (data[0] != 0xFF) || (data[1] != 0xD8))
+		return false;
+
+	// The EXIF parser only needs the APP segments at the start of the file.
+	result.MetaData.Set(data, numBytes);
+
+	int i = 2;
+	while (i + 4 <= numBytes)
+	{
+		if (data[i] != 0xFF)
+			return false;
+
+		uint8 marker = data[i+1];
+		if (marker == 0xFF)				// Fill byte.
+		{
+			i++;
+			continue;
+		}
+
+		// Standalone markers have no length field.
+		if ((marker == 0x01) || (marker == 0xD8) || ((marker >= 0xD0) && (marker <= 0xD7)))
+		{
+			i += 2;
+			continue;
+		}
+
+		// We've hit the start of scan or end of image without finding a frame header.
+		if ((marker == 0xDA) || (marker == 0xD9))
+			return false;
+
+		int segLen = int(ReadBE16(data + i + 2));
+
+		// All SOFn markers except DHT (C4), JPG (C8), and DAC (CC) hold the frame dimensions.
+		bool isSOF = (marker >= 0xC0) && (marker <= 0xCF) && (marker != 0xC4) && (marker != 0xC8) && (marker != 0xCC);
+		if (isSOF)
+		{
+			if (i + 9 > numBytes)
+				return false;
+			result.Height	= int(ReadBE16(data + i + 5));
+			result.Width	= int(ReadBE16(data + i + 7));
+			break;
+		}
+		i += 2 + segLen;
+	}
+
+	// EXIF orientations 5 to 8 include a 90 degree rotation.
+	if (exifOrient && result.MetaData.IsValid() && result.MetaData[tMetaTag::Orientation].IsSet())
+	{
+		uint32 orient = result.MetaData[tMetaTag::Orientation].Uint32;
+		if ((orient >= 5) && (orient <= 8))
+			tStd::tSwap(result.Width, result.Height);
+	}
+
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeGIF(Result& result, const uint8* data, int numBytes)
+{
+	// We use the logical screen size. Every frame is composited onto a canvas of this size.
+	if ((numBytes < 10) || (data[0] != 'G') || (data[1] != 'I') || (data[2] != 'F'))
+		return false;
+
+	result.Width	= int(ReadLE16(data + 6));
+	result.Height	= int(ReadLE16(data + 8));
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeBMP(Result& result, const uint8* data, int numBytes)
+{
+	if ((numBytes < 26) || (data[0] != 'B') || (data[1] != 'M'))
+		return false;
+
+	// A negative height means the rows are stored top-down.
+	result.Width	= tMath::tAbs(int32(ReadLE32(data + 18)));
+	result.Height	= tMath::tAbs(int32(ReadLE32(data + 22)));
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeTGA(Result& result, const uint8* data, int numBytes)
+{
+	// There is no magic number in a TGA header. We rely on the extension and check the image type is sane.
+	if (numBytes < 18)
+		return false;
+
+	uint8 imageType = data[2];
+	bool validType = ((imageType >= 1) && (imageType <= 3)) || ((imageType >= 9) && (imageType <= 11));
+	if (!validType)
+		return false;
+
+	result.Width	= int(ReadLE16(data + 12));
+	result.Height	= int(ReadLE16(data + 14));
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeQOI(Result& result, const uint8* data, int numBytes)
+{
+	if ((numBytes < 14) || (data[0] != 'q') || (data[1] != 'o') || (data[2] != 'i') || (data[3] != 'f'))
+		return false;
+
+	result.Width	= int(ReadBE32(data + 4));
+	result.Height	= int(ReadBE32(data + 8));
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeWEBP(Result& result, const uint8* data, int numBytes)
+{
+	if ((numBytes < 30) || tStd::tMemcmp(data, "RIFF", 4) || tStd::tMemcmp(data + 8, "WEBP", 4))
+		return false;
+
+	const uint8* chunk = data + 12;
+	if (!tStd::tMemcmp(chunk, "VP8X", 4))
+	{
+		// Extended format. Canvas width and height minus one as 24-bit values.
+		result.Width	= int(ReadLE24(data + 24)) + 1;
+		result.Height	= int(ReadLE24(data + 27)) + 1;
+	}
+	else if (!tStd::tMemcmp(chunk, "VP8L", 4))
+	{
+		// Lossless. One signature byte then 14 bits each for width and height minus one.
+		if (data[20] != 0x2F)
+			return false;
+		uint32 bits		= ReadLE32(data + 21);
+		result.Width	= int(bits & 0x3FFF) + 1;
+		result.Height	= int((bits >> 14) & 0x3FFF) + 1;
+	}
+	else if (!tStd::tMemcmp(chunk, "VP8 ", 4))
+	{
+		// Lossy. A 3 byte frame tag then the 3 byte start code then 14-bit dimensions (top 2 bits are scale).
+		if ((data[23] != 0x9D) || (data[24] != 0x01) || (data[25] != 0x2A))
+			return false;
+		result.Width	= int(ReadLE16(data + 26) & 0x3FFF);
+		result.Height	= int(ReadLE16(data + 28) & 0x3FFF);
+	}
+
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeDDS(Result& result, const uint8* data, int numBytes)
+{
+	// Magic then the DDS_HEADER. dwSize and dwFlags come before dwHeight and dwWidth.
+	if ((numBytes < 20) || tStd::tMemcmp(data, "DDS ", 4))
+		return false;
+
+	result.Height	= int(ReadLE32(data + 12));
+	result.Width	= int(ReadLE32(data + 16));
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeKTX(Result& result, const uint8* data, int numBytes)
+{
+	// Both versions share the same first 5 bytes of the 12 byte identifier. The version is in bytes 5 and 6.
+	const uint8 ident[] = { 0xAB, 'K', 'T', 'X', ' ' };
+	if ((numBytes < 44) || tStd::tMemcmp(data, ident, sizeof(ident)))
+		return false;
+
+	if ((data[5] == '1') && (data[6] == '1'))
+	{
+		// KTX1 may be big-endian. The endianness field reads 0x04030201 if it matches the file.
+		bool littleEndian = (ReadLE32(data + 12) == 0x04030201);
+		result.Width	= int(littleEndian ? ReadLE32(data + 36) : ReadBE32(data + 36));
+		result.Height	= int(littleEndian ? ReadLE32(data + 40) : ReadBE32(data + 40));
+	}
+	else if ((data[5] == '2') && (data[6] == '0'))
+	{
+		result.Width	= int(ReadLE32(data + 20));
+		result.Height	= int(ReadLE32(data + 24));
+	}
+
+	// 1D textures have a height of 0.
+	if ((result.Width > 0) && (result.Height == 0))
+		result.Height = 1;
+
+	return result.IsValid();
+}
+
+
+bool Probe::ProbePVR(Result& result, const uint8* data, int numBytes)
+{
+	if (numBytes < 52)
+		return false;
+
+	if (ReadLE32(data) == 0x03525650)
+	{
+		// V3. Version, flags, pixel format (8 bytes), colour space, channel type, then height and width.
+		result.Height	= int(ReadLE32(data + 24));
+		result.Width	= int(ReadLE32(data + 28));
+	}
+	else if ((ReadLE32(data) == 44) || (ReadLE32(data) == 52))
+	{
+		// V1 and V2 legacy headers start with the header size followed by height and width.
+		result.Height	= int(ReadLE32(data + 4));
+		result.Width	= int(ReadLE32(data + 8));
+	}
+
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeASTC(Result& result, const uint8* data, int numBytes)
+{
+	// Magic, 3 block dimension bytes, then 24-bit x, y, and z sizes.
+	if ((numBytes < 16) || (ReadLE32(data) != 0x5CA1AB13))
+		return false;
+
+	result.Width	= int(ReadLE24(data + 7));
+	result.Height	= int(ReadLE24(data + 10));
+	return result.IsValid();
+}
+
+
+bool Probe::ProbePKM(Result& result, const uint8* data, int numBytes)
+{
+	// We want the original (unpadded) dimensions, not the extended multiple-of-4 ones.
+	if ((numBytes < 16) || tStd::tMemcmp(data, "PKM ", 4))
+		return false;
+
+	result.Width	= int(ReadBE16(data + 12));
+	result.Height	= int(ReadBE16(data + 14));
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeHDR(Result& result, const uint8* data, int numBytes)
+{
+	// Radiance files have a text header terminated by a blank line, followed by the resolution string. The standard
+	// orientation is "-Y height +X width". We also accept +Y.
+	if ((numBytes < 11) || (data[0] != '#') || (data[1] != '?'))
+		return false;
+
+	for (int i = 0; i < numBytes - 1; i++)
+	{
+		if ((data[i] != '\n') || ((data[i+1] != '-') && (data[i+1] != '+')) || (i + 3 >= numBytes) || (data[i+2] != 'Y'))
+			continue;
+
+		char line[64];
+		int len = tMath::tMin(numBytes - (i+1), int(sizeof(line)) - 1);
+		tStd::tMemcpy(line, data + i + 1, len);
+		line[len] = '\0';
+
+		int h = 0; int w = 0;
+		if (std::sscanf(line, "%*2s %d %*2s %d", &h, &w) == 2)
+		{
+			result.Width	= w;
+			result.Height	= h;
+		}
+		break;
+	}
+
+	return result.IsValid();
+}
+
+
+bool Probe::ProbeFile(Result& result, const tString& filename, tFileType filetype, bool exifOrient)
+{
+	result.Width = 0;
+	result.Height = 0;
+	result.MetaData.Clear();
+
+	int numBytes = (filetype == tFileType::JPG) ? HeadBytesJPG : HeadBytesDefault;
+	uint8* data = tLoadFileHead(filename, numBytes);
+	if (!data)
+		return false;
+
+	bool ok = false;
+	switch (filetype)
+	{
+		case tFileType::PNG:
+		case tFileType::APNG:	ok = ProbePNG	(result, data, numBytes);				break;
+		case tFileType::JPG:	ok = ProbeJPG	(result, data, numBytes, exifOrient);	break;
+		case tFileType::GIF:	ok = ProbeGIF	(result, data, numBytes);				break;
+		case tFileType::BMP:	ok = ProbeBMP	(result, data, numBytes);				break;
+		case tFileType::TGA:	ok = ProbeTGA	(result, data, numBytes);				break;
+		case tFileType::QOI:	ok = ProbeQOI	(result, data, numBytes);				break;
+		case tFileType::WEBP:	ok = ProbeWEBP	(result, data, numBytes);				break;
+		case tFileType::DDS:	ok = ProbeDDS	(result, data, numBytes);				break;
+		case tFileType::KTX:
+		case tFileType::KTX2:	ok = ProbeKTX	(result, data, numBytes);				break;
+		case tFileType::PVR:	ok = ProbePVR	(result, data, numBytes);				break;
+		case tFileType::ASTC:	ok = ProbeASTC	(result, data, numBytes);				break;
+		case tFileType::PKM:	ok = ProbePKM	(result, data, numBytes);				break;
+		case tFileType::HDR:	ok = ProbeHDR	(result, data, numBytes);				break;
+
+		// EXR, TIFF, and ICO headers are not simple enough to be worth it. These get their dimensions when the
+		// thumbnail is generated.
+		default:																		break;
+	}
+
+	delete[] data;
+
+	// Don't trust anything silly.
+	if (ok && ((result.Width > Viewer::Image::MaxDim) || (result.Height > Viewer::Image::MaxDim)))
+	{
+		result.Width = 0;
+		result.Height = 0;
+		ok = false;
+	}
+
+	return ok;
+}
+
+
+bool Probe::FileReader::Read(uint8* dest, int numBytes)
+{
+	while (numBytes > 0)
+	{
+		if (Pos == End)
+		{
+			BufferOffset += End;
+			Pos = 0;
+			End = tReadFile(File, Buffer, int(sizeof(Buffer)));
+			if (End <= 0)
+			{
+				End = 0;
+				return false;
+			}
+		}
+
+		int count = tMath::tMin(numBytes, End - Pos);
+		tStd::tMemcpy(dest, Buffer + Pos, count);
+		dest += count;
+		Pos += count;
+		numBytes -= count;
+	}
+
+	return true;
+}
+
+
+bool Probe::FileReader::Skip(int64 numBytes)
+{
+	if (numBytes <= int64(End - Pos))
+	{
+		Pos += int(numBytes);
+		return true;
+	}
+
+	// Seek past anything not already buffered. The seek takes an int offset so walking stops 2GB into a file.
+	int64 offset = BufferOffset + int64(Pos) + numBytes;
+	if ((offset > int64(MaxInt)) || (tFileSeek(File, int(offset)) != 0))
+		return false;
+
+	BufferOffset = offset;
+	Pos = 0;
+	End = 0;
+	return true;
+}
+
+
+int Probe::CountFramesGIF(FileReader& reader, int maxFrames)
+{
+	// Header and logical screen descriptor, then the global colour table if there is one.
+	uint8 header[13];
+	if (!reader.Read(header, 13) || (header[0] != 'G') || (header[1] != 'I') || (header[2] != 'F'))
+		return 0;
+	if ((header[10] & 0x80) && !reader.Skip(3 * (1 << ((header[10] & 0x07) + 1))))
+		return 0;
+
+	int numFrames = 0;
+	uint8 intro = 0;
+	while (reader.Read(&intro, 1) && (intro != 0x3B))
+	{
+		if (intro == 0x2C)
+		{
+			// Image descriptor. Skip any local colour table and the LZW minimum code size byte.
+			uint8 descriptor[9];
+			if (!reader.Read(descriptor, 9))
+				break;
+			if ((descriptor[8] & 0x80) && !reader.Skip(3 * (1 << ((descriptor[8] & 0x07) + 1))))
+				break;
+			if (!reader.Skip(1))
+				break;
+
+			numFrames++;
+			if (maxFrames && (numFrames >= maxFrames))
+				break;
+		}
+		else if (intro == 0x21)
+		{
+			// Extension. Skip the label.
+			if (!reader.Skip(1))
+				break;
+		}
+		else
+		{
+			break;
+		}
+
+		// Both image data and extensions are a series of sub-blocks ending with a zero length one.
+		uint8 blockSize = 0;
+		bool ok = true;
+		while ((ok = reader.Read(&blockSize, 1)) && blockSize)
+		{
+			if (!reader.Skip(blockSize))
+			{
+				ok = false;
+				break;
+			}
+		}
+		if (!ok)
+			break;
+	}
+
+	return numFrames;
+}
+
+
+int Probe::CountFramesWEBP(FileReader& reader, int maxFrames)
+{
+	uint8 header[12];
+	if (!reader.Read(header, 12) || tStd::tMemcmp(header, "RIFF", 4) || tStd::tMemcmp(header + 8, "WEBP", 4))
+		return 0;
+
+	// Only the extended format can be animated, and only if the VP8X animation flag is set. Every frame is in an ANMF
+	// chunk. Chunk data is padded to an even size.
+	int numFrames = 0;
+	uint8 chunk[8];
+	while (reader.Read(chunk, 8))
+	{
+		int64 chunkSize = int64(ReadLE32(chunk + 4));
+		int64 paddedSize = chunkSize + (chunkSize & 1);
+		if (!tStd::tMemcmp(chunk, "VP8X", 4))
+		{
+			uint8 flags = 0;
+			if ((chunkSize < 1) || !reader.Read(&flags, 1))
+				break;
+			if (!(flags & 0x02))
+				return 1;
+			paddedSize -= 1;
+		}
+		else if (!tStd::tMemcmp(chunk, "VP8 ", 4) || !tStd::tMemcmp(chunk, "VP8L", 4))
+		{
+			// The simple formats hold a single image.
+			return 1;
+		}
+		else if (!tStd::tMemcmp(chunk, "ANMF", 4))
+		{
+			numFrames++;
+			if (maxFrames && (numFrames >= maxFrames))
+				break;
+		}
+
+		if (!reader.Skip(paddedSize))
+			break;
+	}
+
+	return numFrames;
+}
+
+
+int Probe::CountFramesPNG(FileReader& reader)
+{
+	uint8 signature[8];
+	if (!reader.Read(signature, 8) || (signature[0] != 0x89) || (signature[1] != 'P') || (signature[2] != 'N') || (signature[3] != 'G'))
+		return 0;
+
+	// An APNG must have its acTL chunk before the first IDAT. The frame count is the first field.
+	uint8 chunk[8];
+	while (reader.Read(chunk, 8))
+	{
+		uint32 chunkSize = ReadBE32(chunk);
+		if (!tStd::tMemcmp(chunk + 4, "acTL", 4))
+		{
+			uint8 numFrames[4];
+			if (!reader.Read(numFrames, 4))
+				break;
+			return int(tMath::tMin(ReadBE32(numFrames), uint32(MaxInt)));
+		}
+
+		if (!tStd::tMemcmp(chunk + 4, "IDAT", 4) || !tStd::tMemcmp(chunk + 4, "IEND", 4))
+			return 1;
+
+		// Data then the 4 byte CRC.
+		if (!reader.Skip(int64(chunkSize) + 4))
+			break;
+	}
+
+	return 0;
+}
+
+
+int Probe::CountFrames(const tString& filename, tFileType filetype, int maxFrames)
+{
+	if ((filetype != tFileType::GIF) && (filetype != tFileType::WEBP) && (filetype != tFileType::PNG) && (filetype != tFileType::APNG))
+		return 0;
+
+	// The reader holds a 64KB buffer so it goes on the heap.
+	FileReader* reader = new FileReader(filename);
+	int numFrames = 0;
+	if (reader->IsValid())
+	{
+		switch (filetype)
+		{
+			case tFileType::GIF:	numFrames = CountFramesGIF	(*reader, maxFrames);	break;
+			case tFileType::WEBP:	numFrames = CountFramesWEBP	(*reader, maxFrames);	break;
+			default:				numFrames = CountFramesPNG	(*reader);				break;
+		}
+	}
+
+	delete reader;
+	return numFrames;
+}
+
+
+void Probe::WorkerThread()
+{
+	while (!CancelRequested)
+	{
+		int j = NextJob++;
+		if (j >= NumJobs)
+			break;
+
+		Job& job = Jobs[j];
+		ProbeFile(job.Res, job.Filename, job.Filetype, ExifOrient);
+		job.Done = true;
+	}
+}
+
+
+void Probe::Begin(const tList<Viewer::Image>& images)
+{
+	Cancel();
+
+	NumJobs = images.GetNumItems();
+	if (NumJobs <= 0)
+		return;
+
+	Jobs = new Job[NumJobs];
+	int j = 0;
+	for (Viewer::Image* img = images.First(); img; img = img->Next(), j++)
+	{
+		Jobs[j].Filename = img->Filename;
+		Jobs[j].Filetype = img->Filetype;
+		Jobs[j].Img = img;
+	}
+
+	NextToApply = 0;
+	NextJob = 0;
+	CancelRequested = false;
+	ExifOrient = Viewer::Config::GetProfileData().MetaDataOrientLoading;
+
+	// Probing is mostly waiting on the file system. We use half the cores so thumbnail workers still get a look in.
+	int numThreads = tMath::tClamp(tSystem::tGetNumCores() / 2, 1, NumJobs);
+	for (int t = 0; t < numThreads; t++)
+		Workers.push_back(std::thread(WorkerThread));
+}
+
+
+void Probe::Cancel()
+{
+	CancelRequested = true;
+	for (std::thread& worker : Workers)
+		if (worker.joinable())
+			worker.join();
+	Workers.clear();
+
+	delete[] Jobs;
+	Jobs = nullptr;
+	NumJobs = 0;
+	NextToApply = 0;
+}
+
+
+bool Probe::Update()
+{
+	if (!Jobs)
+		return false;
+
+	bool updated = false;
+	while ((NextToApply < NumJobs) && Jobs[NextToApply].Done)
+	{
+		Job& job = Jobs[NextToApply];
+		Viewer::Image* img = job.Img;
+
+		// A running thumbnail worker owns the image's Cached_ members. It will fill them in itself shortly.
+		if (!img->IsThumbnailWorkerActive())
+		{
+			if (job.Res.IsValid() && (img->Cached_PrimaryWidth == 0))
+			{
+				img->Cached_PrimaryWidth	= job.Res.Width;
+				img->Cached_PrimaryHeight	= job.Res.Height;
+				img->Cached_PrimaryArea		= job.Res.Width * job.Res.Height;
+				updated = true;
+			}
+
+			if (job.Res.MetaData.IsValid() && !img->Cached_MetaData.IsValid())
+			{
+				img->Cached_MetaData = job.Res.MetaData;
+				Viewer::ImagesMetaTable.SetRow(img->MetaRow, img->Cached_MetaData);
+				updated = true;
+			}
+		}
+		NextToApply++;
+	}
+
+	// All done. Free the threads and the job memory.
+	if (NextToApply >= NumJobs)
+		Cancel();
+
+	return updated;
+}
+
+
+bool Probe::IsRunning()
+{
+	return (Jobs != nullptr);
+}
@@ -0,0 +1,60 @@
+// Probe.h
+//
+// Header-only probing of image files. Reads just enough of each file to get the primary image dimensions (and EXIF
+// meta-data for JPGs) without decoding any pixels. This is run on background threads right after a folder is
+// populated so the cached sort keys are meaningful before any thumbnails exist. CountFrames walks the block structure
+// of animations so a load can be refused before it decodes more frames than fit in memory.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Foundation/tList.h>
+#include <Foundation/tString.h>
+#include <System/tFile.h>
+#include <Image/tMetaData.h>
+namespace Viewer { class Image; }
+
+
+namespace Probe
+{
+	struct Result
+	{
+		bool IsValid() const																							{ return (Width > 0) && (Height > 0); }
+		int Width			= 0;
+		int Height			= 0;
+		tImage::tMetaData MetaData;
+	};
+
+	// Reads the file header and fills in the result. Returns false if the type is not supported for probing or the
+	// header could not be parsed. The meta-data may be valid even if false is returned. For JPG files, if
+	// exifOrient is true, the dimensions are swapped for EXIF orientations that include a 90 degree rotation so they
+	// match what a full load (with meta-data orient loading on) produces. This function is thread-safe.
+	bool ProbeFile(Result&, const tString& filename, tSystem::tFileType, bool exifOrient);
+
+	// Counts the frames of a GIF, WEBP, or APNG file by walking its block or chunk structure without decoding
+	// anything. A PNG without an acTL chunk has one frame. Returns 0 for other types or if nothing could be parsed.
+	// If maxFrames is non-zero counting stops once it is reached. A damaged file returns the frames found before the
+	// damage. This function is thread-safe.
+	int CountFrames(const tString& filename, tSystem::tFileType, int maxFrames = 0);
+
+	// Starts background threads probing every image in the list. Any probe already running is cancelled first. The
+	// images list may be cleared after this call as long as Cancel or Begin is called before the next Update.
+	void Begin(const tList<Viewer::Image>& images);
+
+	// Stops all worker threads and discards results. Blocks until the threads are joined.
+	void Cancel();
+
+	// Call from the main thread once per frame. Results that are ready are copied into the Cached_ members of images
+	// that don't already have them (a thumbnail-derived value always wins). Returns true if any image was updated.
+	bool Update();
+
+	bool IsRunning();
+}
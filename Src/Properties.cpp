@@ -264,16 +264,9 @@ void Viewer::ShowPropertiesWindow(bool* popen)
 				}
 			}
 
+			// The alt picture is re-enabled by the reload if it is still available.
 			if (reloadChanges)
-			{
-				CurrImage->Unload();
-				CurrImage->Load();
-				if (altEnabled)
-				{
-					CurrImage->EnableAltPicture(true);
-					CurrImage->Bind();
-				}
-			}
+				CurrImage->Reload();
 
 			// Some DDS files have no available properties. No textures, no properties.
 			// Only one texture and not HDR and no alt images (no mipmaps or cubemap) -> no properties.
@@ -395,16 +388,9 @@ void Viewer::ShowPropertiesWindow(bool* popen)
 				}
 			}
 
+			// The alt picture is re-enabled by the reload if it is still available.
 			if (reloadChanges)
-			{
-				CurrImage->Unload();
-				CurrImage->Load();
-				if (altEnabled)
-				{
-					CurrImage->EnableAltPicture(true);
-					CurrImage->Bind();
-				}
-			}
+				CurrImage->Reload();
 
 			// Some PVR files have no available properties. No textures, no properties.
 			// Only one texture and not HDR and no alt images (no mipmaps or cubemap) -> no properties.
@@ -529,16 +515,9 @@ void Viewer::ShowPropertiesWindow(bool* popen)
 				}
 			}
 
+			// The alt picture is re-enabled by the reload if it is still available.
 			if (reloadChanges)
-			{
-				CurrImage->Unload();
-				CurrImage->Load();
-				if (altEnabled)
-				{
-					CurrImage->EnableAltPicture(true);
-					CurrImage->Bind();
-				}
-			}
+				CurrImage->Reload();
 
 			// Some KTX/KTX2 files have no available properties. No textures, no properties.
 			// If only one texture and not HDR and no alt images (no mipmaps or cubemap) -> no properties.
@@ -648,10 +627,7 @@ void Viewer::ShowPropertiesWindow(bool* popen)
 			}
 
 			if (reloadChanges)
-			{
-				CurrImage->Unload();
-				CurrImage->Load();
-			}
+				CurrImage->Reload();
 
 			ImGui::End();
 			return;
@@ -721,10 +697,7 @@ void Viewer::ShowPropertiesWindow(bool* popen)
 			}
 
 			if (reloadChanges)
-			{
-				CurrImage->Unload();
-				CurrImage->Load();
-			}
+				CurrImage->Reload();
 
 			ImGui::End();
 			return;
@@ -758,10 +731,7 @@ void Viewer::ShowPropertiesWindow(bool* popen)
 			}
 
 			if (reloadChanges)
-			{
-				CurrImage->Unload();
-				CurrImage->Load();
-			}
+				CurrImage->Reload();
 
 			fileTypeSectionDisplayed = true;
 			break;
@@ -816,10 +786,7 @@ void Viewer::ShowPropertiesWindow(bool* popen)
 			}
 
 			if (reloadChanges)
-			{
-				CurrImage->Unload();
-				CurrImage->Load();
-			}
+				CurrImage->Reload();
 
 			fileTypeSectionDisplayed = true;
 			break;
@@ -12,11 +12,18 @@
 // AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
 // PERFORMANCE OF THIS SOFTWARE.
 
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <thread>
 #include "imgui.h"
 #include "Quantize.h"
 #include "Image.h"
 #include "TacentView.h"
 #include "GuiUtil.h"
+#include "PaletteMap.h"
+#include "Task.h"
 using namespace tStd;
 using namespace tSystem;
 using namespace tMath;
@@ -27,6 +34,68 @@ namespace Viewer
 {
 	// Compute a (very) approx number of seconds it will take to quantize on an intel 11th gen mobile CPU.
 	float ComputeApproxQuantizeDuration(const Image* image, tImage::tQuantize::Method method, int numColours);
+
+	// Quantizing can take minutes so it runs as a task against a copy of the image's pictures. The copy replaces the
+	// pictures (with an undo step) when the task finishes.
+	void StartQuantizeTask(Image*, tImage::tQuantize::Method, int numColours, bool checkExact, double ditherLevel, int filterSize, int sampleFactor);
+
+	// Runs quantize on a copy of the picture on its own thread, holding the quantize lock, and moves the result into
+	// the picture. The library quantizers can't stop part way through a frame so if the running task is cancelled this
+	// stops waiting and returns false. The thread finishes in the background and throws its copy away.
+	bool QuantizeCancellable(tImage::tPicture&, const std::function<void(tImage::tPicture&)>& quantize);
+}
+
+
+std::mutex& Viewer::GetQuantizeMutex()
+{
+	// Never destroyed. A cancelled quantize may still be running on its thread at exit.
+	static std::mutex* mutex = new std::mutex;
+	return *mutex;
+}
+
+
+bool Viewer::QuantizeCancellable(tPicture& picture, const std::function<void(tPicture&)>& quantize)
+{
+	// Shared with the thread so whichever of the two finishes last frees it.
+	struct Job
+	{
+		Job(const tPicture& picture)																					: Picture(picture) { }
+		tPicture Picture;
+		std::mutex Mutex;
+		std::condition_variable Finished;
+		bool Done = false;
+	};
+	std::shared_ptr<Job> job = std::make_shared<Job>(picture);
+	std::thread
+	(
+		[job, quantize]()
+		{
+			{
+				const std::lock_guard<std::mutex> lock(GetQuantizeMutex());
+				quantize(job->Picture);
+			}
+			{
+				const std::lock_guard<std::mutex> lock(job->Mutex);
+				job->Done = true;
+			}
+			job->Finished.notify_all();
+		}
+	).detach();
+
+	std::unique_lock<std::mutex> lock(job->Mutex);
+	while (!job->Done)
+	{
+		if (Task::IsCancelled())
+			return false;
+		job->Finished.wait_for(lock, std::chrono::milliseconds(50));
+	}
+
+	int width = job->Picture.GetWidth();
+	int height = job->Picture.GetHeight();
+	float duration = picture.Duration;
+	picture.Set(width, height, job->Picture.StealPixels(), false);
+	picture.Duration = duration;
+	return true;
 }
 
 
@@ -50,6 +119,58 @@ float Viewer::ComputeApproxQuantizeDuration(const Image* image, tImage::tQuantiz
 }
 
 
+void Viewer::StartQuantizeTask
+(
+	Image* image, tImage::tQuantize::Method method, int numColours, bool checkExact,
+	double ditherLevel, int filterSize, int sampleFactor
+)
+{
+	// The fixed palette is the same for every frame so its lookup is built once.
+	std::shared_ptr<PaletteMap> fixedMap;
+	if (method == tQuantize::Method::Fixed)
+	{
+		tColour3b palette[256];
+		PaletteMap::GetFixedPalette(palette, numColours);
+		fixedMap = std::make_shared<PaletteMap>(palette, numColours);
+	}
+
+	// Only the fixed palette lookup is known to be re-entrant, so it is the only method that maps frames concurrently.
+	// The library quantizers take the quantize lock anyway, so they run one frame at a time. Each frame runs through
+	// QuantizeCancellable so cancel works even in the middle of a single large frame. scolorq itself is not split
+	// into tiles. Its palette and dither are solved over the whole image, so tiles would each get their own palette.
+	int maxThreads = (method == tQuantize::Method::Fixed) ? 0 : 1;
+	tString desc; tsPrintf(desc, "Quantize %d", numColours);
+	Task::StartPictureEdit
+	(
+		image, "Quantizing", desc,
+		[=](tPicture& picture)
+		{
+			switch (method)
+			{
+				case tQuantize::Method::Fixed:
+					if (!checkExact || !PaletteMap::HasAtMostColours(picture.GetPixelPointer(), picture.GetArea(), numColours))
+						fixedMap->MapPixels(picture.GetPixelPointer(), picture.GetArea());
+					break;
+
+				case tQuantize::Method::Spatial:
+					QuantizeCancellable(picture, [=](tPicture& pic) { pic.QuantizeSpatial(numColours, checkExact, ditherLevel, filterSize); });
+					break;
+
+				case tQuantize::Method::Neu:
+					QuantizeCancellable(picture, [=](tPicture& pic) { pic.QuantizeNeu(numColours, checkExact, sampleFactor); });
+					break;
+
+				case tQuantize::Method::Wu:
+					QuantizeCancellable(picture, [=](tPicture& pic) { pic.QuantizeWu(numColours, checkExact); });
+					break;
+			}
+		},
+		nullptr,
+		maxThreads
+	);
+}
+
+
 void Viewer::DoQuantizeInterface(int& method, int& spatialFilterSize, float& spatialDitherLevel, int& neuSampleFactor, float itemWidth)
 {
 	if (itemWidth > 0.0f)
@@ -205,31 +326,12 @@ void Viewer::DoQuantizeModal(bool quantizeImagePressed)
 		ImGui::SetKeyboardFocusHere();
 	if (Gutil::Button("Quantize##Button", tVector2(buttonWidth, 0.0f)))
 	{
-		CurrImage->Unbind();
-		switch (tImage::tQuantize::Method(method))
-		{
-			case tImage::tQuantize::Method::Fixed:
-				CurrImage->QuantizeFixed(numColours, checkExact);
-				break;
-
-			case tImage::tQuantize::Method::Spatial:
-			{
-				int filterSize135 = (spatialFilterSize * 2) + 1;
-				CurrImage->QuantizeSpatial(numColours, checkExact, spatialDitherLevel, filterSize135);
-				break;
-			}
-
-			case tImage::tQuantize::Method::Neu:
-				CurrImage->QuantizeNeu(numColours, checkExact, neuSampleFactor);
-				break;
-
-			case tImage::tQuantize::Method::Wu:
-				CurrImage->QuantizeWu(numColours, checkExact);
-				break;
-		}
-		CurrImage->Bind();
-		Gutil::SetWindowTitle();
-
+		int filterSize135 = (spatialFilterSize * 2) + 1;
+		StartQuantizeTask
+		(
+			CurrImage, tImage::tQuantize::Method(method), numColours, checkExact,
+			double(spatialDitherLevel), filterSize135, neuSampleFactor
+		);
 		ImGui::CloseCurrentPopup();
 	}
 	ImGui::EndPopup();
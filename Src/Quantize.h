@@ -13,10 +13,15 @@
 // PERFORMANCE OF THIS SOFTWARE.
 
 #pragma once
+#include <mutex>
 
 
 namespace Viewer
 {
+	// The Spatial (scolorq), Neu, and Wu quantizers in the image library are not known to be re-entrant. Anything that
+	// may run them, including GIF saves, holds this lock so threads take turns. The fixed palette needs no lock.
+	std::mutex& GetQuantizeMutex();
+
 	void DoQuantizeModal(bool quantizeImagePressed);
 	void DoQuantizeInterface
 	(
@@ -0,0 +1,840 @@
+// Resampler.cpp
+//
+// A separable resampler for 8-bit RGBA pictures. The filter weights for each axis depend only on the source length,
+// destination length, filter and edge mode, so they are computed once and cached. The horizontal and vertical passes
+// use 16-bit fixed-point weights with SSE2 kernels on x64 and are spread across threads in bands of rows. Filters
+// that are not supported here fall back on tPicture::Resample.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <Foundation/tFundamentals.h>
+#include "Resampler.h"
+#include "Parallel.h"
+#if defined(ARCHITECTURE_X64)
+#include <emmintrin.h>
+#endif
+using namespace tMath;
+using namespace tImage;
+
+
+namespace Resampler
+{
+	// Weights are signed 16-bit with this many fractional bits. The largest weight of any supported filter is a
+	// little over 1.0 so there is plenty of headroom, and a tap pair times 255 fits easily in the 32-bit sums.
+	const int WeightBits	= 14;
+	const int WeightOne		= 1 << WeightBits;
+	const int WeightRound	= 1 << (WeightBits-1);
+
+	// Each job of a pass produces roughly this many destination pixels.
+	const int PixelsPerJob	= 64*1024;
+
+	// Every destination sample along an axis reads NumTaps source samples. The tap count is the same for every sample
+	// and always even so the SIMD kernels can take the taps in pairs. Unused taps have a weight of 0.
+	struct AxisWeights
+	{
+		int NumTaps = 0;
+		std::vector<int> Index;				// DstLength*NumTaps source indices, already edge-mode adjusted.
+		std::vector<int16> Weight;			// DstLength*NumTaps fixed-point weights. Each sample's weights sum to WeightOne.
+	};
+
+	struct WeightsKey
+	{
+		int SrcLength;
+		int DstLength;
+		tResampleFilter Filter;
+		tResampleEdgeMode EdgeMode;
+		bool operator<(const WeightsKey& k) const
+		{
+			if (SrcLength != k.SrcLength)	return SrcLength < k.SrcLength;
+			if (DstLength != k.DstLength)	return DstLength < k.DstLength;
+			if (Filter != k.Filter)			return Filter < k.Filter;
+			return EdgeMode < k.EdgeMode;
+		}
+	};
+
+	// Batch jobs resize many images with the same few dimensions so the cache stays tiny. It is simply emptied if it
+	// gets bigger than this.
+	const int MaxCachedWeights = 64;
+	std::mutex WeightsCacheMutex;
+	std::map<WeightsKey, std::shared_ptr<const AxisWeights>> WeightsCache;
+
+	float FilterRadius(tResampleFilter);
+	float FilterKernel(tResampleFilter, float x);
+	float CubicBC(float x, float b, float c);
+	float Sinc(float x);
+
+	int ApplyEdgeMode(int index, int length, tResampleEdgeMode);
+	void ComputeWeights(AxisWeights&, int srcLength, int dstLength, tResampleFilter, tResampleEdgeMode);
+	std::shared_ptr<const AxisWeights> GetWeights(int srcLength, int dstLength, tResampleFilter, tResampleEdgeMode);
+
+	void ResampleRow(tColour4b* dst, const tColour4b* src, int dstW, const AxisWeights&);
+	void ResampleColumns(tColour4b* dst, const tColour4b* const* srcRows, const int16* weights, int numTaps, int width);
+	tColour4b WeightedSum(const tColour4b* taps, const int16* weights, int numTaps);
+	void RotateRow(tColour4b* dst, int y, int dstW, int dstH, const tColour4b* src, int srcW, int srcH, float cosA, float sinA, const tColour4b& fill, tResampleFilter kernel);
+	void BoxDownscaleRows(tColour4b* dst, const tColour4b* src, int srcW, int dstW, int factorX, int factorY, int beginRow, int endRow);
+	void BoxDownscaleRowsLinear(tColour4b* dst, const tColour4b* src, int srcW, int dstW, int factorX, int factorY, int beginRow, int endRow);
+	inline uint8 Saturate(int v)																						{ return uint8(tClamp(v >> WeightBits, 0, 255)); }
+}
+
+
+bool Resampler::IsSupported(tResampleFilter filter)
+{
+	switch (filter)
+	{
+		case tResampleFilter::Nearest:
+		case tResampleFilter::Box:
+		case tResampleFilter::Bilinear:
+		case tResampleFilter::Bicubic_CatmullRom:
+		case tResampleFilter::Bicubic_Mitchell:
+		case tResampleFilter::Bicubic_BSpline:
+		case tResampleFilter::Lanczos_Narrow:
+		case tResampleFilter::Lanczos_Normal:
+		case tResampleFilter::Lanczos_Wide:
+			return true;
+
+		default:
+			break;
+	}
+	return false;
+}
+
+
+float Resampler::FilterRadius(tResampleFilter filter)
+{
+	switch (filter)
+	{
+		case tResampleFilter::Box:					return 0.5f;
+		case tResampleFilter::Bilinear:				return 1.0f;
+		case tResampleFilter::Bicubic_CatmullRom:
+		case tResampleFilter::Bicubic_Mitchell:
+		case tResampleFilter::Bicubic_BSpline:
+		case tResampleFilter::Lanczos_Narrow:		return 2.0f;
+		case tResampleFilter::Lanczos_Normal:		return 3.0f;
+		case tResampleFilter::Lanczos_Wide:			return 4.0f;
+		default:									break;
+	}
+	return 0.0f;
+}
+
+
+float Resampler::CubicBC(float x, float b, float c)
+{
+	// Mitchell-Netravali family. (b, c) of (0, 1/2) is Catmull-Rom, (1/3, 1/3) is Mitchell, and (1, 0) is the B-spline.
+	x = tAbs(x);
+	if (x < 1.0f)
+		return ((12.0f - 9.0f*b - 6.0f*c)*x*x*x + (-18.0f + 12.0f*b + 6.0f*c)*x*x + (6.0f - 2.0f*b)) / 6.0f;
+	if (x < 2.0f)
+		return ((-b - 6.0f*c)*x*x*x + (6.0f*b + 30.0f*c)*x*x + (-12.0f*b - 48.0f*c)*x + (8.0f*b + 24.0f*c)) / 6.0f;
+	return 0.0f;
+}
+
+
+float Resampler::Sinc(float x)
+{
+	if (tAbs(x) < 1.0e-6f)
+		return 1.0f;
+	x *= tPi;
+	return std::sin(x) / x;
+}
+
+
+float Resampler::FilterKernel(tResampleFilter filter, float x)
+{
+	switch (filter)
+	{
+		case tResampleFilter::Box:					return ((x > -0.5f) && (x <= 0.5f)) ? 1.0f : 0.0f;
+		case tResampleFilter::Bilinear:				return tMax(1.0f - tAbs(x), 0.0f);
+		case tResampleFilter::Bicubic_CatmullRom:	return CubicBC(x, 0.0f, 0.5f);
+		case tResampleFilter::Bicubic_Mitchell:		return CubicBC(x, 1.0f/3.0f, 1.0f/3.0f);
+		case tResampleFilter::Bicubic_BSpline:		return CubicBC(x, 1.0f, 0.0f);
+		case tResampleFilter::Lanczos_Narrow:		return (tAbs(x) < 2.0f) ? Sinc(x)*Sinc(x/2.0f) : 0.0f;
+		case tResampleFilter::Lanczos_Normal:		return (tAbs(x) < 3.0f) ? Sinc(x)*Sinc(x/3.0f) : 0.0f;
+		case tResampleFilter::Lanczos_Wide:			return (tAbs(x) < 4.0f) ? Sinc(x)*Sinc(x/4.0f) : 0.0f;
+		default:									break;
+	}
+	return 0.0f;
+}
+
+
+int Resampler::ApplyEdgeMode(int index, int length, tResampleEdgeMode edgeMode)
+{
+	if (edgeMode == tResampleEdgeMode::Wrap)
+		return ((index % length) + length) % length;
+	return tClamp(index, 0, length-1);
+}
+
+
+void Resampler::ComputeWeights(AxisWeights& weights, int srcLength, int dstLength, tResampleFilter filter, tResampleEdgeMode edgeMode)
+{
+	// Sample centres are at half-integers in both spaces. When minifying the kernel is stretched by the scale so
+	// every source sample contributes.
+	double scale = double(srcLength) / double(dstLength);
+	double filterScale = tMax(scale, 1.0);
+	bool nearest = (filter == tResampleFilter::Nearest);
+	double support = nearest ? 0.0 : double(FilterRadius(filter)) * filterScale;
+
+	// First work out the float weights for every sample to find the tap count.
+	std::vector<int> first(dstLength);
+	std::vector<std::vector<double>> contrib(dstLength);
+	int maxTaps = 1;
+	for (int d = 0; d < dstLength; d++)
+	{
+		double centre = (double(d) + 0.5) * scale;
+		if (nearest)
+		{
+			first[d] = tClamp(int(std::floor(centre)), 0, srcLength-1);
+			contrib[d].push_back(1.0);
+			continue;
+		}
+
+		int lo = int(std::floor(centre - support));
+		int hi = int(std::ceil(centre + support));
+		double total = 0.0;
+		for (int s = lo; s < hi; s++)
+		{
+			double w = FilterKernel(filter, float((double(s) + 0.5 - centre) / filterScale));
+			contrib[d].push_back(w);
+			total += w;
+		}
+
+		// Trim zero weights off both ends so narrow kernels don't carry dead taps.
+		std::vector<double>& c = contrib[d];
+		int start = 0;
+		while ((start < int(c.size())-1) && (c[start] == 0.0))
+			start++;
+		int end = int(c.size());
+		while ((end > start+1) && (c[end-1] == 0.0))
+			end--;
+
+		if (total == 0.0)
+		{
+			// Can't happen for sensible sizes, but a lone sample is better than black.
+			first[d] = tClamp(int(std::floor(centre)), 0, srcLength-1);
+			c.assign(1, 1.0);
+			continue;
+		}
+
+		first[d] = lo + start;
+		c = std::vector<double>(c.begin()+start, c.begin()+end);
+		for (double& w : c)
+			w /= total;
+		tiClampMin(maxTaps, int(c.size()));
+	}
+
+	weights.NumTaps = (maxTaps + 1) & ~1;
+	weights.Index.assign(size_t(dstLength) * weights.NumTaps, 0);
+	weights.Weight.assign(size_t(dstLength) * weights.NumTaps, 0);
+	for (int d = 0; d < dstLength; d++)
+	{
+		const std::vector<double>& c = contrib[d];
+		int* index = &weights.Index[size_t(d) * weights.NumTaps];
+		int16* weight = &weights.Weight[size_t(d) * weights.NumTaps];
+
+		// Round to fixed point and give any rounding error to the biggest weight so flat colours stay exact.
+		int sum = 0;
+		int biggest = 0;
+		for (int t = 0; t < int(c.size()); t++)
+		{
+			int src = nearest ? first[d] : ApplyEdgeMode(first[d] + t, srcLength, edgeMode);
+			index[t] = src;
+			weight[t] = int16(std::lround(c[t] * WeightOne));
+			sum += weight[t];
+			if (tAbs(int(weight[t])) > tAbs(int(weight[biggest])))
+				biggest = t;
+		}
+		weight[biggest] = int16(weight[biggest] + (WeightOne - sum));
+
+		// Padding taps read a valid sample with no weight.
+		for (int t = int(c.size()); t < weights.NumTaps; t++)
+			index[t] = index[0];
+	}
+}
+
+
+std::shared_ptr<const Resampler::AxisWeights> Resampler::GetWeights(int srcLength, int dstLength, tResampleFilter filter, tResampleEdgeMode edgeMode)
+{
+	WeightsKey key { srcLength, dstLength, filter, edgeMode };
+	{
+		const std::lock_guard<std::mutex> lock(WeightsCacheMutex);
+		auto found = WeightsCache.find(key);
+		if (found != WeightsCache.end())
+			return found->second;
+	}
+
+	// Computed outside the lock. Two threads may both compute the same weights, which is harmless.
+	std::shared_ptr<AxisWeights> weights = std::make_shared<AxisWeights>();
+	ComputeWeights(*weights, srcLength, dstLength, filter, edgeMode);
+
+	const std::lock_guard<std::mutex> lock(WeightsCacheMutex);
+	if (int(WeightsCache.size()) >= MaxCachedWeights)
+		WeightsCache.clear();
+	WeightsCache[key] = weights;
+	return weights;
+}
+
+
+void Resampler::ResampleRow(tColour4b* dst, const tColour4b* src, int dstW, const AxisWeights& weights)
+{
+	int numTaps = weights.NumTaps;
+	const int* index = weights.Index.data();
+	const int16* weight = weights.Weight.data();
+
+	#if defined(ARCHITECTURE_X64)
+	const __m128i zero = _mm_setzero_si128();
+	for (int d = 0; d < dstW; d++, index += numTaps, weight += numTaps)
+	{
+		__m128i acc = _mm_set1_epi32(WeightRound);
+		for (int t = 0; t < numTaps; t += 2)
+		{
+			// Interleave the two source pixels so each 32-bit lane of the multiply-add is one channel of both taps.
+			int32 p0, p1;
+			std::memcpy(&p0, &src[index[t]], 4);
+			std::memcpy(&p1, &src[index[t+1]], 4);
+			__m128i pair = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p0), _mm_cvtsi32_si128(p1)), zero);
+			__m128i w = _mm_set1_epi32(int32(uint16(weight[t])) | (int32(weight[t+1]) << 16));
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(pair, w));
+		}
+		acc = _mm_srai_epi32(acc, WeightBits);
+		acc = _mm_packs_epi32(acc, acc);
+		acc = _mm_packus_epi16(acc, acc);
+		int32 out = _mm_cvtsi128_si32(acc);
+		std::memcpy(&dst[d], &out, 4);
+	}
+
+	#else
+	for (int d = 0; d < dstW; d++, index += numTaps, weight += numTaps)
+	{
+		int r = WeightRound, g = WeightRound, b = WeightRound, a = WeightRound;
+		for (int t = 0; t < numTaps; t++)
+		{
+			const tColour4b& p = src[index[t]];
+			int w = weight[t];
+			r += w*p.R;	g += w*p.G;	b += w*p.B;	a += w*p.A;
+		}
+		dst[d].Set(Saturate(r), Saturate(g), Saturate(b), Saturate(a));
+	}
+	#endif
+}
+
+
+void Resampler::ResampleColumns(tColour4b* dst, const tColour4b* const* srcRows, const int16* weight, int numTaps, int width)
+{
+	int x = 0;
+
+	#if defined(ARCHITECTURE_X64)
+	// Four pixels (16 channels) at a time. Two source rows are interleaved per multiply-add.
+	const __m128i zero = _mm_setzero_si128();
+	for (; x+4 <= width; x += 4)
+	{
+		__m128i acc0 = _mm_set1_epi32(WeightRound);
+		__m128i acc1 = acc0, acc2 = acc0, acc3 = acc0;
+		for (int t = 0; t < numTaps; t += 2)
+		{
+			__m128i row0 = _mm_loadu_si128((const __m128i*)(srcRows[t] + x));
+			__m128i row1 = _mm_loadu_si128((const __m128i*)(srcRows[t+1] + x));
+			__m128i lo = _mm_unpacklo_epi8(row0, row1);
+			__m128i hi = _mm_unpackhi_epi8(row0, row1);
+			__m128i w = _mm_set1_epi32(int32(uint16(weight[t])) | (int32(weight[t+1]) << 16));
+			acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+			acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+			acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+			acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+		}
+		__m128i out01 = _mm_packs_epi32(_mm_srai_epi32(acc0, WeightBits), _mm_srai_epi32(acc1, WeightBits));
+		__m128i out23 = _mm_packs_epi32(_mm_srai_epi32(acc2, WeightBits), _mm_srai_epi32(acc3, WeightBits));
+		_mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(out01, out23));
+	}
+	#endif
+
+	for (; x < width; x++)
+	{
+		int r = WeightRound, g = WeightRound, b = WeightRound, a = WeightRound;
+		for (int t = 0; t < numTaps; t++)
+		{
+			const tColour4b& p = srcRows[t][x];
+			int w = weight[t];
+			r += w*p.R;	g += w*p.G;	b += w*p.B;	a += w*p.A;
+		}
+		dst[x].Set(Saturate(r), Saturate(g), Saturate(b), Saturate(a));
+	}
+}
+
+
+tColour4b* Resampler::Resample
+(
+	const tColour4b* src, int srcW, int srcH, int dstW, int dstH,
+	tResampleFilter filter, tResampleEdgeMode edgeMode
+)
+{
+	tAssert(IsSupported(filter));
+	tColour4b* dst = new tColour4b[size_t(dstW) * size_t(dstH)];
+
+	// Horizontal pass into an intermediate of dstW x srcH. Skipped if the width doesn't change.
+	tColour4b* horiz = nullptr;
+	const tColour4b* vertSrc = src;
+	if (dstW != srcW)
+	{
+		std::shared_ptr<const AxisWeights> weights = GetWeights(srcW, dstW, filter, edgeMode);
+		bool direct = (dstH == srcH);
+		horiz = direct ? dst : new tColour4b[size_t(dstW) * size_t(srcH)];
+		int rowsPerJob = tMax(PixelsPerJob / dstW, 1);
+		int numJobs = (srcH + rowsPerJob - 1) / rowsPerJob;
+		Parallel::For
+		(
+			numJobs,
+			[&](int job)
+			{
+				int endRow = tMin((job+1)*rowsPerJob, srcH);
+				for (int y = job*rowsPerJob; y < endRow; y++)
+					ResampleRow(horiz + size_t(y)*dstW, src + size_t(y)*srcW, dstW, *weights);
+			}
+		);
+		if (direct)
+			return dst;
+		vertSrc = horiz;
+	}
+
+	// Vertical pass.
+	if (dstH != srcH)
+	{
+		std::shared_ptr<const AxisWeights> weights = GetWeights(srcH, dstH, filter, edgeMode);
+		int numTaps = weights->NumTaps;
+		int rowsPerJob = tMax(PixelsPerJob / dstW, 1);
+		int numJobs = (dstH + rowsPerJob - 1) / rowsPerJob;
+		Parallel::For
+		(
+			numJobs,
+			[&](int job)
+			{
+				std::vector<const tColour4b*> srcRows(numTaps);
+				int endRow = tMin((job+1)*rowsPerJob, dstH);
+				for (int y = job*rowsPerJob; y < endRow; y++)
+				{
+					const int* index = &weights->Index[size_t(y) * numTaps];
+					for (int t = 0; t < numTaps; t++)
+						srcRows[t] = vertSrc + size_t(index[t])*dstW;
+					ResampleColumns(dst + size_t(y)*dstW, srcRows.data(), &weights->Weight[size_t(y) * numTaps], numTaps, dstW);
+				}
+			}
+		);
+	}
+	else
+	{
+		std::memcpy(dst, vertSrc, size_t(dstW) * size_t(dstH) * sizeof(tColour4b));
+	}
+
+	delete[] horiz;
+	return dst;
+}
+
+
+tColour4b Resampler::WeightedSum(const tColour4b* taps, const int16* weight, int numTaps)
+{
+	tColour4b result;
+
+	#if defined(ARCHITECTURE_X64)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = _mm_set1_epi32(WeightRound);
+	for (int t = 0; t < numTaps; t += 2)
+	{
+		int32 p0, p1;
+		std::memcpy(&p0, &taps[t], 4);
+		std::memcpy(&p1, &taps[t+1], 4);
+		__m128i pair = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(p0), _mm_cvtsi32_si128(p1)), zero);
+		__m128i w = _mm_set1_epi32(int32(uint16(weight[t])) | (int32(weight[t+1]) << 16));
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(pair, w));
+	}
+	acc = _mm_srai_epi32(acc, WeightBits);
+	acc = _mm_packs_epi32(acc, acc);
+	acc = _mm_packus_epi16(acc, acc);
+	int32 out = _mm_cvtsi128_si32(acc);
+	std::memcpy(&result, &out, 4);
+
+	#else
+	int r = WeightRound, g = WeightRound, b = WeightRound, a = WeightRound;
+	for (int t = 0; t < numTaps; t++)
+	{
+		int w = weight[t];
+		r += w*taps[t].R;	g += w*taps[t].G;	b += w*taps[t].B;	a += w*taps[t].A;
+	}
+	result.Set(Saturate(r), Saturate(g), Saturate(b), Saturate(a));
+	#endif
+
+	return result;
+}
+
+
+bool Resampler::IsRotateDirect(tResampleFilter upFilter, tResampleFilter downFilter)
+{
+	switch (upFilter)
+	{
+		case tResampleFilter::None:
+			return (downFilter == tResampleFilter::None);
+
+		case tResampleFilter::Bilinear:
+		case tResampleFilter::Bicubic_CatmullRom:
+		case tResampleFilter::Bicubic_Mitchell:
+		case tResampleFilter::Bicubic_BSpline:
+			return true;
+
+		default:
+			break;
+	}
+	return false;
+}
+
+
+void Resampler::RotateRow
+(
+	tColour4b* dst, int y, int dstW, int dstH, const tColour4b* src, int srcW, int srcH,
+	float cosA, float sinA, const tColour4b& fill, tResampleFilter kernel
+)
+{
+	// Each output pixel centre is rotated back into the source by the inverse (transpose) rotation. Source positions
+	// are in pixel-centre space so integer values land exactly on a source pixel.
+	int size = 1;
+	if (kernel == tResampleFilter::Bilinear)
+		size = 2;
+	else if (kernel != tResampleFilter::Nearest)
+		size = 4;
+	int first = (size == 4) ? -1 : 0;
+
+	float dy = float(y) + 0.5f - 0.5f*float(dstH);
+	for (int x = 0; x < dstW; x++)
+	{
+		float dx = float(x) + 0.5f - 0.5f*float(dstW);
+		float sx =  cosA*dx + sinA*dy + 0.5f*float(srcW) - 0.5f;
+		float sy = -sinA*dx + cosA*dy + 0.5f*float(srcH) - 0.5f;
+
+		if (size == 1)
+		{
+			int ix = int(std::floor(sx + 0.5f));
+			int iy = int(std::floor(sy + 0.5f));
+			bool inside = (ix >= 0) && (ix < srcW) && (iy >= 0) && (iy < srcH);
+			dst[x] = inside ? src[size_t(iy)*srcW + ix] : fill;
+			continue;
+		}
+
+		int baseX = int(std::floor(sx));
+		int baseY = int(std::floor(sy));
+		int x0 = baseX + first;
+		int y0 = baseY + first;
+		if ((x0 >= srcW) || (y0 >= srcH) || (x0+size <= 0) || (y0+size <= 0))
+		{
+			dst[x] = fill;
+			continue;
+		}
+
+		float fx = sx - float(baseX);
+		float fy = sy - float(baseY);
+		float wx[4], wy[4];
+		for (int t = 0; t < size; t++)
+		{
+			float ox = float(t + first) - fx;
+			float oy = float(t + first) - fy;
+			wx[t] = FilterKernel(kernel, ox);
+			wy[t] = FilterKernel(kernel, oy);
+		}
+
+		// Gather the taps. Anything off the source reads the fill colour so edges blend smoothly into it.
+		tColour4b taps[16];
+		int16 weights[16];
+		int numTaps = size*size;
+		bool inside = (x0 >= 0) && (y0 >= 0) && (x0+size <= srcW) && (y0+size <= srcH);
+		int sum = 0;
+		int biggest = 0;
+		for (int j = 0; j < size; j++)
+		{
+			int sampY = y0 + j;
+			for (int i = 0; i < size; i++)
+			{
+				int sampX = x0 + i;
+				int t = j*size + i;
+				if (inside || ((sampX >= 0) && (sampX < srcW) && (sampY >= 0) && (sampY < srcH)))
+					taps[t] = src[size_t(sampY)*srcW + sampX];
+				else
+					taps[t] = fill;
+
+				weights[t] = int16(std::lround(wx[i]*wy[j]*float(WeightOne)));
+				sum += weights[t];
+				if (tAbs(int(weights[t])) > tAbs(int(weights[biggest])))
+					biggest = t;
+			}
+		}
+		weights[biggest] = int16(weights[biggest] + (WeightOne - sum));
+		dst[x] = WeightedSum(taps, weights, numTaps);
+	}
+}
+
+
+bool Resampler::RotateCenter(tPicture& picture, float angle, const tColour4b& fill, tResampleFilter upFilter, tResampleFilter downFilter)
+{
+	if (!picture.IsValid())
+		return false;
+
+	if (!IsRotateDirect(upFilter, downFilter))
+	{
+		picture.RotateCenter(angle, fill, upFilter, downFilter);
+		return true;
+	}
+
+	tResampleFilter kernel = (upFilter == tResampleFilter::None) ? tResampleFilter::Nearest : upFilter;
+	int srcW = picture.GetWidth();
+	int srcH = picture.GetHeight();
+	float cosA = std::cos(angle);
+	float sinA = std::sin(angle);
+
+	// The small bias stops exact multiples of 90 degrees gaining an extra row or column from float error.
+	float extentW = tAbs(float(srcW)*cosA) + tAbs(float(srcH)*sinA);
+	float extentH = tAbs(float(srcW)*sinA) + tAbs(float(srcH)*cosA);
+	int dstW = tMax(int(std::ceil(extentW - 0.001f)), 1);
+	int dstH = tMax(int(std::ceil(extentH - 0.001f)), 1);
+
+	const tColour4b* src = picture.GetPixelPointer();
+	tColour4b* dst = new tColour4b[size_t(dstW) * size_t(dstH)];
+	int rowsPerJob = tMax(PixelsPerJob / dstW, 1);
+	int numJobs = (dstH + rowsPerJob - 1) / rowsPerJob;
+	Parallel::For
+	(
+		numJobs,
+		[&](int job)
+		{
+			int endRow = tMin((job+1)*rowsPerJob, dstH);
+			for (int y = job*rowsPerJob; y < endRow; y++)
+				RotateRow(dst + size_t(y)*dstW, y, dstW, dstH, src, srcW, srcH, cosA, sinA, fill, kernel);
+		}
+	);
+
+	float duration = picture.Duration;
+	picture.Set(dstW, dstH, dst, false);
+	picture.Duration = duration;
+	return true;
+}
+
+
+bool Resampler::IsIntegerDownscale(int srcW, int srcH, int dstW, int dstH)
+{
+	if ((dstW <= 0) || (dstH <= 0) || (dstW > srcW) || (dstH > srcH))
+		return false;
+
+	if ((dstW == srcW) && (dstH == srcH))
+		return false;
+
+	return ((srcW % dstW) == 0) && ((srcH % dstH) == 0);
+}
+
+
+void Resampler::BoxDownscaleRows(tColour4b* dst, const tColour4b* src, int srcW, int dstW, int factorX, int factorY, int beginRow, int endRow)
+{
+	// The factorY source rows are summed into per-channel column totals first, then each run of factorX columns is
+	// summed and scaled. The float scale is exact for any sensible factor and matches the scalar path bit for bit.
+	int numChannels = srcW*4;
+	std::vector<uint32> sums(numChannels);
+	float scale = 1.0f / float(factorX*factorY);
+
+	#if defined(ARCHITECTURE_X64)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scaleV = _mm_set1_ps(scale);
+	const __m128 half = _mm_set1_ps(0.5f);
+	#endif
+
+	for (int y = beginRow; y < endRow; y++)
+	{
+		std::fill(sums.begin(), sums.end(), 0);
+		for (int r = 0; r < factorY; r++)
+		{
+			const uint8* row = (const uint8*)(src + size_t(y*factorY + r)*srcW);
+			uint32* sum = sums.data();
+			int c = 0;
+
+			#if defined(ARCHITECTURE_X64)
+			for (; c+16 <= numChannels; c += 16)
+			{
+				__m128i p = _mm_loadu_si128((const __m128i*)(row + c));
+				__m128i lo = _mm_unpacklo_epi8(p, zero);
+				__m128i hi = _mm_unpackhi_epi8(p, zero);
+				__m128i* s = (__m128i*)(sum + c);
+				_mm_storeu_si128(s+0, _mm_add_epi32(_mm_loadu_si128(s+0), _mm_unpacklo_epi16(lo, zero)));
+				_mm_storeu_si128(s+1, _mm_add_epi32(_mm_loadu_si128(s+1), _mm_unpackhi_epi16(lo, zero)));
+				_mm_storeu_si128(s+2, _mm_add_epi32(_mm_loadu_si128(s+2), _mm_unpacklo_epi16(hi, zero)));
+				_mm_storeu_si128(s+3, _mm_add_epi32(_mm_loadu_si128(s+3), _mm_unpackhi_epi16(hi, zero)));
+			}
+			#endif
+
+			for (; c < numChannels; c++)
+				sum[c] += row[c];
+		}
+
+		tColour4b* out = dst + size_t(y)*dstW;
+		for (int x = 0; x < dstW; x++)
+		{
+			const uint32* block = sums.data() + size_t(x)*factorX*4;
+
+			#if defined(ARCHITECTURE_X64)
+			// One pixel's four channel sums fill a register exactly.
+			__m128i acc = zero;
+			for (int i = 0; i < factorX; i++)
+				acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i*)(block + i*4)));
+			__m128i avg = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(acc), scaleV), half));
+			avg = _mm_packs_epi32(avg, avg);
+			avg = _mm_packus_epi16(avg, avg);
+			int32 pixel = _mm_cvtsi128_si32(avg);
+			std::memcpy(&out[x], &pixel, 4);
+
+			#else
+			uint32 acc[4] = { 0, 0, 0, 0 };
+			for (int i = 0; i < factorX; i++)
+				for (int c = 0; c < 4; c++)
+					acc[c] += block[i*4 + c];
+			out[x].Set
+			(
+				uint8(float(acc[0])*scale + 0.5f), uint8(float(acc[1])*scale + 0.5f),
+				uint8(float(acc[2])*scale + 0.5f), uint8(float(acc[3])*scale + 0.5f)
+			);
+			#endif
+		}
+	}
+}
+
+
+namespace Resampler
+{
+	// sRGB transfer tables for gamma-correct averaging. Linear values are floats in [0,1]. The way back uses a 4096
+	// entry table, which is fine enough that every 8-bit sRGB value round-trips.
+	const int LinearTableSize = 4096;
+	struct GammaTables
+	{
+		GammaTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = float(i) / 255.0f;
+				ToLinear[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < LinearTableSize; i++)
+			{
+				float l = float(i) / float(LinearTableSize-1);
+				float c = (l <= 0.0031308f) ? l * 12.92f : 1.055f*std::pow(l, 1.0f/2.4f) - 0.055f;
+				ToSRGB[i] = uint8(tClamp(int(c*255.0f + 0.5f), 0, 255));
+			}
+		}
+		float ToLinear[256];
+		uint8 ToSRGB[LinearTableSize];
+	};
+
+	const GammaTables& GetGammaTables()																					{ static const GammaTables tables; return tables; }
+}
+
+
+void Resampler::BoxDownscaleRowsLinear(tColour4b* dst, const tColour4b* src, int srcW, int dstW, int factorX, int factorY, int beginRow, int endRow)
+{
+	// Same structure as BoxDownscaleRows but the colour channels are summed as linear floats. Alpha is summed as-is.
+	const GammaTables& tables = GetGammaTables();
+	std::vector<float> sums(size_t(srcW)*4);
+	float scale = 1.0f / float(factorX*factorY);
+	float toIndex = scale * float(LinearTableSize-1);
+
+	for (int y = beginRow; y < endRow; y++)
+	{
+		std::fill(sums.begin(), sums.end(), 0.0f);
+		for (int r = 0; r < factorY; r++)
+		{
+			const tColour4b* row = src + size_t(y*factorY + r)*srcW;
+			float* sum = sums.data();
+			for (int c = 0; c < srcW; c++, sum += 4)
+			{
+				sum[0] += tables.ToLinear[row[c].R];
+				sum[1] += tables.ToLinear[row[c].G];
+				sum[2] += tables.ToLinear[row[c].B];
+				sum[3] += float(row[c].A);
+			}
+		}
+
+		tColour4b* out = dst + size_t(y)*dstW;
+		for (int x = 0; x < dstW; x++)
+		{
+			const float* block = sums.data() + size_t(x)*factorX*4;
+			float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (int i = 0; i < factorX; i++)
+				for (int c = 0; c < 4; c++)
+					acc[c] += block[i*4 + c];
+
+			out[x].Set
+			(
+				tables.ToSRGB[tClamp(int(acc[0]*toIndex + 0.5f), 0, LinearTableSize-1)],
+				tables.ToSRGB[tClamp(int(acc[1]*toIndex + 0.5f), 0, LinearTableSize-1)],
+				tables.ToSRGB[tClamp(int(acc[2]*toIndex + 0.5f), 0, LinearTableSize-1)],
+				uint8(tClamp(int(acc[3]*scale + 0.5f), 0, 255))
+			);
+		}
+	}
+}
+
+
+tColour4b* Resampler::BoxDownscale(const tColour4b* src, int srcW, int srcH, int dstW, int dstH, bool gammaCorrect)
+{
+	tAssert(IsIntegerDownscale(srcW, srcH, dstW, dstH));
+	int factorX = srcW / dstW;
+	int factorY = srcH / dstH;
+	tColour4b* dst = new tColour4b[size_t(dstW) * size_t(dstH)];
+
+	// Jobs are sized by source pixels read since that is where the work is.
+	int rowsPerJob = tMax(PixelsPerJob / (srcW*factorY), 1);
+	int numJobs = (dstH + rowsPerJob - 1) / rowsPerJob;
+	Parallel::For
+	(
+		numJobs,
+		[&](int job)
+		{
+			int beginRow = job*rowsPerJob;
+			int endRow = tMin(beginRow + rowsPerJob, dstH);
+			if (gammaCorrect)
+				BoxDownscaleRowsLinear(dst, src, srcW, dstW, factorX, factorY, beginRow, endRow);
+			else
+				BoxDownscaleRows(dst, src, srcW, dstW, factorX, factorY, beginRow, endRow);
+		}
+	);
+
+	return dst;
+}
+
+
+bool Resampler::Resample(tPicture& picture, int newWidth, int newHeight, tResampleFilter filter, tResampleEdgeMode edgeMode, bool gammaCorrect)
+{
+	if (!picture.IsValid() || (newWidth <= 0) || (newHeight <= 0))
+		return false;
+
+	if (!IsSupported(filter))
+		return picture.Resample(newWidth, newHeight, filter, edgeMode);
+
+	int srcW = picture.GetWidth();
+	int srcH = picture.GetHeight();
+	if ((srcW == newWidth) && (srcH == newHeight))
+		return true;
+
+	tColour4b* pixels = nullptr;
+	if ((filter == tResampleFilter::Box) && IsIntegerDownscale(srcW, srcH, newWidth, newHeight))
+		pixels = BoxDownscale(picture.GetPixelPointer(), srcW, srcH, newWidth, newHeight, gammaCorrect);
+	else
+		pixels = Resample(picture.GetPixelPointer(), srcW, srcH, newWidth, newHeight, filter, edgeMode);
+
+	float duration = picture.Duration;
+	picture.Set(newWidth, newHeight, pixels, false);
+	picture.Duration = duration;
+	return true;
+}
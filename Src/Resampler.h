@@ -0,0 +1,72 @@
+// Resampler.h
+//
+// A separable resampler for 8-bit RGBA pictures. The filter weights for each axis depend only on the source length,
+// destination length, filter and edge mode, so they are computed once and cached. The horizontal and vertical passes
+// use 16-bit fixed-point weights with SSE2 kernels on x64 and are spread across threads in bands of rows. Filters
+// that are not supported here fall back on tPicture::Resample.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <Image/tPicture.h>
+#include <Image/tResample.h>
+
+
+namespace Resampler
+{
+	// Returns true if the filter is handled by this resampler. Box, bilinear, the Catmull-Rom, Mitchell and B-spline
+	// bicubics, and the Lanczos filters are. Nearest is handled as point sampling.
+	bool IsSupported(tImage::tResampleFilter);
+
+	// Resamples the picture in place to the new size. Uses tPicture::Resample for unsupported filters. Returns false
+	// if the picture is invalid or the new size is not positive. Safe to call on different pictures from different
+	// threads. When called from inside a Parallel::For the passes run on the calling thread. With the box filter an
+	// integer-ratio reduction goes through BoxDownscale, which is an exact area average and much faster. gammaCorrect
+	// only applies to that path.
+	bool Resample
+	(
+		tImage::tPicture&, int newWidth, int newHeight,
+		tImage::tResampleFilter = tImage::tResampleFilter::Bilinear,
+		tImage::tResampleEdgeMode = tImage::tResampleEdgeMode::Clamp,
+		bool gammaCorrect = false
+	);
+
+	// Same as above but reads from src and writes a newly allocated destination buffer of dstW*dstH pixels that the
+	// caller owns (delete[]). Rows are in the same order as the source. Only supported filters may be passed.
+	tColour4b* Resample
+	(
+		const tColour4b* src, int srcW, int srcH, int dstW, int dstH,
+		tImage::tResampleFilter, tImage::tResampleEdgeMode
+	);
+
+	// Returns true if RotateCenter samples the source directly for this filter pair. That is the case if both filters
+	// are None (nearest) or the up filter is bilinear or the Catmull-Rom, Mitchell or B-spline bicubic.
+	bool IsRotateDirect(tImage::tResampleFilter upFilter, tImage::tResampleFilter downFilter);
+
+	// Rotates the picture anticlockwise by angle radians about its centre. The picture becomes the size of the rotated
+	// bounding box and uncovered pixels get the fill colour. When IsRotateDirect is true every output pixel samples
+	// the source once with the up filter's kernel, with bands of output rows on separate threads. This avoids the
+	// upsample, rotate and downsample of tPicture::RotateCenter, which is used for all other filter pairs.
+	bool RotateCenter
+	(
+		tImage::tPicture&, float angle, const tColour4b& fill,
+		tImage::tResampleFilter upFilter, tImage::tResampleFilter downFilter
+	);
+
+	// Returns true if both source dimensions are whole multiples of the destination ones and the size changes.
+	bool IsIntegerDownscale(int srcW, int srcH, int dstW, int dstH);
+
+	// Averages each (srcW/dstW) x (srcH/dstH) block of source pixels into one destination pixel. The dimensions must
+	// satisfy IsIntegerDownscale. If gammaCorrect is true the colour channels are averaged as linear light rather than
+	// sRGB values, which keeps fine detail from darkening. Alpha is always averaged linearly. Returns a new buffer the
+	// caller owns (delete[]).
+	tColour4b* BoxDownscale(const tColour4b* src, int srcW, int srcH, int dstW, int dstH, bool gammaCorrect);
+}
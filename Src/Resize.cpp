@@ -17,6 +17,8 @@
 #include "Image.h"
 #include "TacentView.h"
 #include "GuiUtil.h"
+#include "Resampler.h"
+#include "Task.h"
 using namespace tStd;
 using namespace tSystem;
 using namespace tMath;
@@ -326,11 +328,21 @@ void Viewer::DoResizeImageModal(bool resizeImagePressed)
 	{
 		if ((dstW != srcW) || (dstH != srcH))
 		{
-			CurrImage->Unbind();
-			CurrImage->Resample(dstW, dstH, tImage::tResampleFilter(profile.ResampleFilter), tImage::tResampleEdgeMode(profile.ResampleEdgeMode));
-			CurrImage->Bind();
-			Gutil::SetWindowTitle();
-			Viewer::ZoomDownscaleOnly();
+			int newW = dstW;
+			int newH = dstH;
+			tResampleFilter filter = tResampleFilter(profile.ResampleFilter);
+			tResampleEdgeMode edgeMode = tResampleEdgeMode(profile.ResampleEdgeMode);
+			tString desc; tsPrintf(desc, "Resample %d %d", newW, newH);
+			Task::StartPictureEdit
+			(
+				CurrImage, "Resizing", desc,
+				[newW, newH, filter, edgeMode](tPicture& picture)
+				{
+					if ((picture.GetWidth() != newW) || (picture.GetHeight() != newH))
+						Resampler::Resample(picture, newW, newH, filter, edgeMode);
+				},
+				[]() { Viewer::ZoomDownscaleOnly(); }
+			);
 		}
 		ImGui::CloseCurrentPopup();
 	}
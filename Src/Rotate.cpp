@@ -18,6 +18,8 @@
 #include "TacentView.h"
 #include "GuiUtil.h"
 #include "Config.h"
+#include "Resampler.h"
+#include "Task.h"
 using namespace tStd;
 using namespace tSystem;
 using namespace tMath;
@@ -117,57 +119,67 @@ void Viewer::DoRotateImageModal(bool rotateImagePressed)
 			ImGui::EndPopup();
 			return;
 		}
-		int origW = picture->GetWidth();
-		int origH = picture->GetHeight();
-
-		CurrImage->Unbind();
-		CurrImage->Rotate
-		(
-			tDegToRad(RotateAnglePreview), profile.FillColour,
-			tResampleFilter(profile.ResampleFilterRotateUp),
-			tResampleFilter(profile.ResampleFilterRotateDown)
-		);
-
-		if ((profile.GetRotateMode() == Config::ProfileData::RotateModeEnum::Crop) || (profile.GetRotateMode() == Config::ProfileData::RotateModeEnum::CropResize))
+		float angle = tDegToRad(RotateAnglePreview);
+		if (angle != 0.0f)
 		{
-			// If one of the crop modes is selected we need to crop the edges. Since rectangles are made of lines and there
-			// is symmetry and we can compute the reduced size by subtracting the original size from the rotated size.
-			int rotW = picture->GetWidth();
-			int rotH = picture->GetHeight();
-			bool aspectFlip = ((origW > origH) && (rotW < rotH)) || ((origW < origH) && (rotW > rotH));
-			if (aspectFlip)
-				tSwap(origW, origH);
-
-			int dx = rotW - origW;
-			int dy = rotH - origH;
-			int newW = origW - dx;
-			int newH = origH - dy;
-
-			if (dx > origW/2)
-			{
-				newW = origW - origW/2;
-				newH = (newW*origH)/origW;
-			}
-			else if (dy > origH/2)
-			{
-				newH = origH - origH/2;
-				newW = (newH*origW)/origH;
-			}
-
-			// The above code has been tested with a 1x1 input and (newH,newW) result correcty as (1,1). 
-			CurrImage->Crop(newW, newH, tPicture::Anchor::MiddleMiddle);
-		}
-
-		if (profile.GetRotateMode() == Config::ProfileData::RotateModeEnum::CropResize)
-		{
-			// The crop is done. Now resample.
-			tResampleFilter filter = (profile.ResampleFilterRotateUp != int(tResampleFilter::None)) ? tResampleFilter(profile.ResampleFilterRotateUp) : tResampleFilter::Nearest;
-			CurrImage->Resample(origW, origH, filter, tResampleEdgeMode::Clamp);
+			tColour4b fill = profile.FillColour;
+			tResampleFilter upFilter = tResampleFilter(profile.ResampleFilterRotateUp);
+			tResampleFilter downFilter = tResampleFilter(profile.ResampleFilterRotateDown);
+			Config::ProfileData::RotateModeEnum mode = profile.GetRotateMode();
+			tString desc; tsPrintf(desc, "Rotate %.1f", RotateAnglePreview);
+			Task::StartPictureEdit
+			(
+				CurrImage, "Rotating", desc,
+				[angle, fill, upFilter, downFilter, mode](tPicture& picture)
+				{
+					int origW = picture.GetWidth();
+					int origH = picture.GetHeight();
+					Resampler::RotateCenter(picture, angle, fill, upFilter, downFilter);
+
+					if ((mode == Config::ProfileData::RotateModeEnum::Crop) || (mode == Config::ProfileData::RotateModeEnum::CropResize))
+					{
+						// If one of the crop modes is selected we need to crop the edges. Since rectangles are made of
+						// lines and there is symmetry and we can compute the reduced size by subtracting the original
+						// size from the rotated size.
+						int rotW = picture.GetWidth();
+						int rotH = picture.GetHeight();
+						bool aspectFlip = ((origW > origH) && (rotW < rotH)) || ((origW < origH) && (rotW > rotH));
+						if (aspectFlip)
+							tSwap(origW, origH);
+
+						int dx = rotW - origW;
+						int dy = rotH - origH;
+						int newW = origW - dx;
+						int newH = origH - dy;
+
+						if (dx > origW/2)
+						{
+							newW = origW - origW/2;
+							newH = (newW*origH)/origW;
+						}
+						else if (dy > origH/2)
+						{
+							newH = origH - origH/2;
+							newW = (newH*origW)/origH;
+						}
+
+						// The above code has been tested with a 1x1 input and (newH,newW) result correcty as (1,1).
+						if ((newW != rotW) || (newH != rotH))
+							picture.Crop(newW, newH, tPicture::Anchor::MiddleMiddle, tColour4b::black);
+					}
+
+					if (mode == Config::ProfileData::RotateModeEnum::CropResize)
+					{
+						// The crop is done. Now resample.
+						tResampleFilter filter = (upFilter != tResampleFilter::None) ? upFilter : tResampleFilter::Nearest;
+						if ((picture.GetWidth() != origW) || (picture.GetHeight() != origH))
+							Resampler::Resample(picture, origW, origH, filter, tResampleEdgeMode::Clamp);
+					}
+				}
+			);
 		}
 
-		CurrImage->Bind();
 		RotateAnglePreview = 0.0f;
-		Gutil::SetWindowTitle();
 		ImGui::CloseCurrentPopup();
 	}
 	ImGui::EndPopup();
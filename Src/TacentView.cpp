@@ -47,6 +47,9 @@
 #include "TacentView.h"
 #include "GuiUtil.h"
 #include "Image.h"
+#include "MetaTable.h"
+#include "Probe.h"
+#include "Task.h"
 #include "ColourDialogs.h"
 #include "ImportRaw.h"
 #include "Dialogs.h"
@@ -341,8 +344,9 @@ namespace Viewer
 	// result in ascending order if they return a < b and descending if they return a > b.
 	struct ImageCompareFunctionObject
 	{
-		ImageCompareFunctionObject(Config::ProfileData::SortKeyEnum key, bool ascending) : Key(key), Ascending(ascending) { }
+		ImageCompareFunctionObject(Config::ProfileData::SortKeyEnum key, bool ascending) : Key(key), MetaColumn(MetaTable::GetColumn(key)), Ascending(ascending) { }
 		Config::ProfileData::SortKeyEnum Key;
+		MetaTable::Column MetaColumn;
 		bool Ascending;
 
 		// This is what makes it a magical function object.
@@ -509,125 +513,26 @@ bool Viewer::ImageCompareFunctionObject::operator() (const Image& a, const Image
 		}
 
 		case Config::ProfileData::SortKeyEnum::MetaLatitude:
-		{
-			float A = a.Cached_MetaData[tImage::tMetaTag::LatitudeDD].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::LatitudeDD].Float : -100.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::LatitudeDD].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::LatitudeDD].Float : -100.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaLongitude:
-		{
-			float A = a.Cached_MetaData[tImage::tMetaTag::LongitudeDD].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::LongitudeDD].Float : -200.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::LongitudeDD].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::LongitudeDD].Float : -200.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaAltitude:
-		{
-			float A = a.Cached_MetaData[tImage::tMetaTag::Altitude].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::Altitude].Float : -1000.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::Altitude].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::Altitude].Float : -1000.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaRoll:
-		{
-			float A = a.Cached_MetaData[tImage::tMetaTag::Roll].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::Roll].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::Roll].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::Roll].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaPitch:
-		{
-			float A = a.Cached_MetaData[tImage::tMetaTag::Pitch].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::Pitch].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::Pitch].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::Pitch].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaYaw:
-		{
-			float A = a.Cached_MetaData[tImage::tMetaTag::Yaw].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::Yaw].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::Yaw].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::Yaw].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaSpeed:
-		{
-			float A = a.Cached_MetaData[tImage::tMetaTag::Speed].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::Speed].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::Speed].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::Speed].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaShutterSpeed:
-		{
-			// Camera Shutter 'Speed' is measured in 1/s. 125 => 1/125th second. 0.0 (infinite) is considered the default for sorting purposes.
-			float A = a.Cached_MetaData[tImage::tMetaTag::ShutterSpeed].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::ShutterSpeed].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::ShutterSpeed].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::ShutterSpeed].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaExposureTime:
-		{
-			// Exposure time is how long the shutter is open for. Basically the inverse of the shutter speed.
-			// I don't know why EXIF data duplicates this explicitely. 0.0s is considered the default for exposure time.
-			float A = a.Cached_MetaData[tImage::tMetaTag::ExposureTime].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::ExposureTime].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::ExposureTime].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::ExposureTime].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaFStop:
-		{
-			// No existing lens can get down to an f-stop of 0.5. That;s why we use 0.5 as the default.
-			float A = a.Cached_MetaData[tImage::tMetaTag::FStop].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::FStop].Float : 0.5f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::FStop].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::FStop].Float : 0.5f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaISO:
-		{
-			// ISO as low as 25 exist. 100-200 is 'normal' speed film. 400 is fast (but grainy). We use 0 as default.
-			float A = a.Cached_MetaData[tImage::tMetaTag::ISO].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::ISO].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::ISO].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::ISO].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaAperture:
-		{
-			// Aperture in APEX units can't get down to 0. We use 0 as default.
-			float A = a.Cached_MetaData[tImage::tMetaTag::Aperture].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::Aperture].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::Aperture].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::Aperture].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaOrientation:
-		{
-			// All non-90-degree transforms are grouped at the start. All 90-degree transforms have larger values.
-			// This allows for meaningful sorting. The default 0 means 'unspecified'.
-			uint32 A = a.Cached_MetaData[tImage::tMetaTag::Orientation].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::Orientation].Uint32 : 0;
-			uint32 B = b.Cached_MetaData[tImage::tMetaTag::Orientation].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::Orientation].Uint32 : 0;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaBrightness:
-		{
-			// Aperture in APEX Bv units. 0 is dark -- about 3.4candelas/(m^2). We use 0 as default.
-			float A = a.Cached_MetaData[tImage::tMetaTag::Brightness].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::Brightness].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::Brightness].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::Brightness].Float : 0.0f;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaFlash:
-		{
-			// Flash used is 0 for not used, 1 for used. We use 0 for default.
-			uint32 A = a.Cached_MetaData[tImage::tMetaTag::FlashUsed].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::FlashUsed].Uint32 : 0;
-			uint32 B = b.Cached_MetaData[tImage::tMetaTag::FlashUsed].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::FlashUsed].Uint32 : 0;
-			return Ascending ? (A < B) : (A > B);
-		}
-
 		case Config::ProfileData::SortKeyEnum::MetaFocalLength:
 		{
-			// Focal length in mm.  We use 0 as default which means unknown.
-			float A = a.Cached_MetaData[tImage::tMetaTag::FocalLength].IsSet() ? a.Cached_MetaData[tImage::tMetaTag::FocalLength].Float : 0.0f;
-			float B = b.Cached_MetaData[tImage::tMetaTag::FocalLength].IsSet() ? b.Cached_MetaData[tImage::tMetaTag::FocalLength].Float : 0.0f;
+			// The numeric meta-data keys are read from the compact meta-data table. Each key has its own contiguous
+			// column and unset values already hold the sort default for that key. See MetaTable.cpp for the defaults.
+			float A = ImagesMetaTable.Get(a.MetaRow, MetaColumn);
+			float B = ImagesMetaTable.Get(b.MetaRow, MetaColumn);
 			return Ascending ? (A < B) : (A > B);
 		}
 
@@ -795,8 +700,11 @@ void Viewer::PopulateImagesSubDirs()
 
 void Viewer::PopulateImages()
 {
+	// The probe workers don't touch the images, but the results reference them so they must go first.
+	Probe::Cancel();
 	Images.Clear();
 	ImagesLoadTimeSorted.Clear();
+	ImagesMetaTable.Clear();
 
 	tList<tSystem::tFileInfo> foundFiles;
 	ImagesDir = FindImagesInImageToLoadDir(foundFiles);
@@ -817,11 +725,26 @@ void Viewer::PopulateImages()
 	Config::ProfileData& profile = Config::GetProfileData();
 	SortImages(profile.GetSortKey(), profile.SortAscending);
 	CurrImage = nullptr;
+
+	// Read the headers of all the images in the background so the dimension and meta-data sort keys are valid long
+	// before the thumbnails are generated.
+	Probe::Begin(Images);
 }
 
 
 void Viewer::SortImages(Config::ProfileData::SortKeyEnum key, bool ascending)
 {
+	// Images may be appended to the list from a few places (paste, import, save-as). Any that don't have a meta-data
+	// table row yet get one here so the numeric meta-data sort keys can read from it.
+	for (Image* img = Images.First(); img; img = img->Next())
+	{
+		if (img->MetaRow < 0)
+		{
+			img->MetaRow = ImagesMetaTable.AddRow();
+			ImagesMetaTable.SetRow(img->MetaRow, img->Cached_MetaData);
+		}
+	}
+
 	ImageCompareFunctionObject compObj(key, ascending);
 	Images.Sort(compObj);
 }
@@ -2626,6 +2549,9 @@ int Viewer::DoMainMenuBar()
 	DoQuantizeModal					(quantizePressed);
 	DoLosslessTransformModal		(losslessTransformPressed);
 
+	// Long operations started by the modals above run as tasks. This draws their progress popup.
+	Task::Update();
+
 	return menuBarHeight;
 }
 
@@ -2883,6 +2809,24 @@ void Viewer::Update(GLFWwindow* window, double dt, bool dopoll)
 		glfwPollEvents();
 
 	Config::ProfileData& profile = Config::GetProfileData();
+
+	// Apply any header probe results that are ready. If we're sorting by a cached key the order may have changed. We
+	// don't resort every frame while results are streaming in as that's expensive for big folders.
+	static double lastProbeSortTime = 0.0;
+	static bool probeSortPending = false;
+	if (Probe::Update())
+		probeSortPending = true;
+	if (probeSortPending && Config::ProfileData::IsCachedSortKey(profile.GetSortKey()))
+	{
+		double currTime = tSystem::tGetTime();
+		if (!Probe::IsRunning() || ((currTime - lastProbeSortTime) > 0.25))
+		{
+			SortImages(profile.GetSortKey(), profile.SortAscending);
+			lastProbeSortTime = currTime;
+			probeSortPending = false;
+		}
+	}
+
 	if (Config::Global.TransparentWorkArea)
 		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	else
@@ -4577,7 +4521,10 @@ int main(int argc, char** argv)
 
 	// This is important. We need the destructors to run BEFORE we shutdown GLFW. Deconstructing the images may block for a bit while shutting
 	// down worker threads. We could show a 'shutting down' popup here if we wanted -- if Image::ThumbnailNumThreadsRunning is > 0.
+	Task::CancelAndWait();
+	Probe::Cancel();
 	Viewer::Images.Clear();
+	Viewer::ImagesMetaTable.Clear();
 	Viewer::UnloadAppImages();
 
 	// Get current window geometry and set in config file if we're not in fullscreen mode and not iconified.
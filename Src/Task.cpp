@@ -0,0 +1,288 @@
+// Task.cpp
+//
+// Runs long GUI operations on a worker thread so the window keeps drawing. While a task runs a modal progress popup
+// with a cancel button is shown, which also blocks input to the rest of the viewer. When the work returns, the
+// finish function is called on the main thread so results can be swapped into images and re-bound.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#include <thread>
+#include <vector>
+#include <System/tTime.h>
+#include "imgui.h"
+#include "Task.h"
+#include "GuiUtil.h"
+#include "Image.h"
+#include "Parallel.h"
+#include "TacentView.h"
+using namespace tMath;
+
+
+namespace Task
+{
+	std::thread Worker;
+	std::atomic<bool> WorkDone	{ false };
+	Context* CurrContext		= nullptr;
+	tString CurrName;
+	FinishFunc CurrFinish;
+	double StartTime			= 0.0;
+
+	std::mutex PostedMutex;
+	std::vector<std::function<void()>> Posted;
+
+	void RunPosted();
+	void Finish();
+}
+
+
+bool Task::Start(const tString& name, const WorkFunc& work, const FinishFunc& finish)
+{
+	if (IsRunning())
+		return false;
+
+	CurrContext		= new Context();
+	CurrName		= name;
+	CurrFinish		= finish;
+	StartTime		= tSystem::tGetTime();
+	WorkDone		= false;
+
+	Context* context = CurrContext;
+	Worker = std::thread
+	(
+		[work, context]()
+		{
+			work(*context);
+			WorkDone = true;
+		}
+	);
+	return true;
+}
+
+
+bool Task::IsRunning()
+{
+	return Worker.joinable();
+}
+
+
+bool Task::IsCancelled()
+{
+	// The context is only deleted after the worker is joined.
+	return CurrContext && CurrContext->IsCancelled();
+}
+
+
+void Task::Post(const std::function<void()>& func)
+{
+	const std::lock_guard<std::mutex> lock(PostedMutex);
+	Posted.push_back(func);
+}
+
+
+void Task::RunPosted()
+{
+	// Swapped out first so the functions run without the lock held.
+	std::vector<std::function<void()>> posted;
+	{
+		const std::lock_guard<std::mutex> lock(PostedMutex);
+		posted.swap(Posted);
+	}
+	for (const std::function<void()>& func : posted)
+		func();
+}
+
+
+void Task::Finish()
+{
+	Worker.join();
+	RunPosted();
+	bool cancelled = CurrContext->IsCancelled();
+	delete CurrContext;
+	CurrContext = nullptr;
+
+	// Cleared before the call so the finish function may start another task.
+	FinishFunc finish = CurrFinish;
+	CurrFinish = nullptr;
+	if (finish)
+		finish(cancelled);
+}
+
+
+void Task::Update()
+{
+	if (!IsRunning())
+		return;
+
+	RunPosted();
+	const char* popupName = "Working##Task";
+	if (!ImGui::IsPopupOpen(popupName))
+		ImGui::OpenPopup(popupName);
+
+	float modalWidth = Gutil::GetUIParamScaled(308.0f, 2.5f);
+	ImGui::SetNextWindowSize(tVector2(modalWidth, 0.0f));
+	if (ImGui::BeginPopupModal(popupName, nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoScrollbar))
+	{
+		ImGui::Text("%s", CurrName.Chr());
+
+		float progress = tSaturate(CurrContext->GetProgress());
+		tString overlay;
+		tsPrintf(overlay, "%d%%  %.1fs", int(progress*100.0f), float(tSystem::tGetTime() - StartTime));
+		ImGui::ProgressBar(progress, tVector2(-1.0f, 0.0f), overlay.Chr());
+
+		// The work can only stop between its units of work so cancelling may take a moment.
+		float buttonWidth = Gutil::GetUIParamScaled(76.0f, 2.5f);
+		if (CurrContext->IsCancelled())
+			ImGui::Text("Cancelling...");
+		else if (Gutil::Button("Cancel", tVector2(buttonWidth, 0.0f)))
+			CurrContext->Cancel();
+
+		if (WorkDone)
+			ImGui::CloseCurrentPopup();
+		ImGui::EndPopup();
+	}
+
+	if (WorkDone)
+		Finish();
+}
+
+
+void Task::CancelAndWait()
+{
+	if (!IsRunning())
+		return;
+
+	CurrContext->Cancel();
+	Finish();
+}
+
+
+bool Task::StartPictureEdit
+(
+	Viewer::Image* image, const tString& name, const tString& undoDesc,
+	const std::function<void(tImage::tPicture&)>& edit, const std::function<void()>& done, int maxThreads
+)
+{
+	if (!image || IsRunning())
+		return false;
+
+	tList<tImage::tPicture>* pictures = new tList<tImage::tPicture>;
+	image->CopyPictures(*pictures);
+
+	bool started = Start
+	(
+		name,
+		[pictures, edit, maxThreads](Context& context)
+		{
+			std::vector<tImage::tPicture*> pictureTable;
+			for (tImage::tPicture* picture = pictures->First(); picture; picture = picture->Next())
+				pictureTable.push_back(picture);
+
+			int numPictures = int(pictureTable.size());
+			std::atomic<int> numDone { 0 };
+			Parallel::For
+			(
+				numPictures,
+				[&](int p)
+				{
+					if (context.IsCancelled())
+						return;
+					edit(*pictureTable[p]);
+					context.SetProgress(float(++numDone) / float(numPictures));
+				},
+				maxThreads
+			);
+		},
+		[image, pictures, undoDesc, done](bool cancelled)
+		{
+			// The progress popup blocks input so the current image can't normally change. This is just a safety check.
+			if (!cancelled && (image == Viewer::CurrImage))
+			{
+				image->SetPictures(*pictures, undoDesc);
+				image->Bind();
+				Gutil::SetWindowTitle();
+				if (done)
+					done();
+			}
+			delete pictures;
+		}
+	);
+
+	if (!started)
+		delete pictures;
+	return started;
+}
+
+
+void Task::MemoryBudget::Acquire(int64 bytes)
+{
+	std::unique_lock<std::mutex> lock(Mutex);
+	Released.wait(lock, [this, bytes]() { return (HeldBytes == 0) || (HeldBytes + bytes <= MaxBytes); });
+	HeldBytes += bytes;
+}
+
+
+void Task::MemoryBudget::Release(int64 bytes)
+{
+	{
+		const std::lock_guard<std::mutex> lock(Mutex);
+		HeldBytes -= bytes;
+	}
+	Released.notify_all();
+}
+
+
+Task::ImageSnapshot::ImageSnapshot(const Viewer::Image& image) :
+	Filename(image.Filename)
+{
+	tImage::tPicture* picture = image.IsLoaded() ? image.GetCurrentPic() : nullptr;
+	if (picture)
+	{
+		Picture = new tImage::tPicture(*picture);
+		EstimatedBytes = int64(picture->GetWidth()) * int64(picture->GetHeight()) * int64(sizeof(tPixel4b));
+	}
+	else
+	{
+		Loader = image.CreateLoadCopy();
+		EstimatedBytes = int64(image.Cached_PrimaryWidth) * int64(image.Cached_PrimaryHeight) * int64(sizeof(tPixel4b));
+	}
+}
+
+
+Task::ImageSnapshot::~ImageSnapshot()
+{
+	delete Picture;
+	delete Loader;
+}
+
+
+tImage::tPicture* Task::ImageSnapshot::GetPicture()
+{
+	if (!Picture && Loader)
+	{
+		if (Loader->Load())
+		{
+			// The loader is thrown away so its pixels are taken rather than copied.
+			tImage::tPicture* picture = Loader->GetCurrentPic();
+			if (picture && picture->IsValid())
+			{
+				int width = picture->GetWidth();
+				int height = picture->GetHeight();
+				float duration = picture->Duration;
+				Picture = new tImage::tPicture();
+				Picture->Set(width, height, picture->StealPixels(), false);
+				Picture->Duration = duration;
+			}
+		}
+		delete Loader;
+		Loader = nullptr;
+	}
+	return Picture;
+}
@@ -0,0 +1,120 @@
+// Task.h
+//
+// Runs long GUI operations on a worker thread so the window keeps drawing. While a task runs a modal progress popup
+// with a cancel button is shown, which also blocks input to the rest of the viewer. When the work returns, the
+// finish function is called on the main thread so results can be swapped into images and re-bound.
+//
+// Copyright (c) 2024 Tristan Grimmer.
+// Permission to use, copy, modify, and/or distribute this software for any purpose with or without fee is hereby
+// granted, provided that the above copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+// INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+// AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+// PERFORMANCE OF THIS SOFTWARE.
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <Foundation/tString.h>
+#include <Image/tPicture.h>
+namespace Viewer { class Image; }
+
+
+namespace Task
+{
+	// Passed to the work function. The work should check IsCancelled between units of work (frames, files) and return
+	// early if set. Progress is a fraction in [0, 1] and may be set from any thread.
+	class Context
+	{
+	public:
+		bool IsCancelled() const																						{ return Cancelled; }
+		void SetProgress(float progress)																				{ Progress = progress; }
+		float GetProgress() const																						{ return Progress; }
+		void Cancel()																									{ Cancelled = true; }
+
+	private:
+		std::atomic<bool> Cancelled		{ false };
+		std::atomic<float> Progress		{ 0.0f };
+	};
+
+	// The work function runs on the worker thread and must not touch OpenGL or any Image the main thread may draw.
+	// Operate on copies and hand them over in the finish function. cancelled is true if the user pressed cancel.
+	typedef std::function<void(Context&)> WorkFunc;
+	typedef std::function<void(bool cancelled)> FinishFunc;
+
+	// Starts a task. Only one runs at a time. Returns false (and does nothing) if a task is already running. The name
+	// is shown in the progress popup.
+	bool Start(const tString& name, const WorkFunc&, const FinishFunc&);
+	bool IsRunning();
+
+	// Returns true if the running task has been asked to stop. Safe to call from the work function and any threads it
+	// starts while it runs. Lets edit functions that only get a picture give up early.
+	bool IsCancelled();
+
+	// Call once per frame from the main thread, inside the ImGui frame. Draws the progress popup and calls the finish
+	// function once the work has returned.
+	void Update();
+
+	// Queues a function to run on the main thread during Update. May be called from any thread while a task runs. Lets
+	// the work hand results over as they become ready. Anything still queued when the work returns runs before the
+	// finish function.
+	void Post(const std::function<void()>&);
+
+	// Asks the running task to stop and blocks until the worker returns. The finish function is called with cancelled
+	// set. Used on shutdown.
+	void CancelAndWait();
+
+	// Starts a task that runs edit on a copy of every frame of the image. Frames are spread over up to maxThreads
+	// threads (0 for all cores). Use 1 if edit may not run concurrently on different pictures. Unless cancelled, the
+	// copies replace the image's pictures as a single undo step named undoDesc, the image is re-bound, and done (if
+	// supplied) is called on the main thread.
+	bool StartPictureEdit
+	(
+		Viewer::Image*, const tString& name, const tString& undoDesc,
+		const std::function<void(tImage::tPicture&)>& edit, const std::function<void()>& done = nullptr, int maxThreads = 0
+	);
+
+	// Caps the memory held by concurrent jobs of a task. Acquire blocks until the bytes fit in the budget. A request
+	// larger than the whole budget goes through once nothing else is held so it can't wait forever.
+	class MemoryBudget
+	{
+	public:
+		MemoryBudget(int64 maxBytes)																					: MaxBytes(maxBytes) { }
+		void Acquire(int64 bytes);
+		void Release(int64 bytes);
+
+	private:
+		std::mutex Mutex;
+		std::condition_variable Released;
+		int64 MaxBytes;
+		int64 HeldBytes				= 0;
+	};
+
+	// The current frame of an image, captured on the main thread for a task to use. A loaded image has its current
+	// picture copied right away, which keeps any unsaved edits. Otherwise the file is loaded later by GetPicture into
+	// a private copy of the image so the worker never touches an image in the Images list.
+	class ImageSnapshot
+	{
+	public:
+		ImageSnapshot(const Viewer::Image&);
+		~ImageSnapshot();
+
+		// Call from the worker. Returns nullptr if the image could not be loaded. The snapshot keeps ownership but the
+		// caller may steal the pixels.
+		tImage::tPicture* GetPicture();
+
+		// The size of the decoded picture in bytes, known before GetPicture is called. Based on the image's cached
+		// dimensions if it isn't loaded. Returns 0 if they aren't known yet.
+		int64 GetEstimatedBytes() const																					{ return EstimatedBytes; }
+		tString Filename;
+
+	private:
+		tImage::tPicture* Picture	= nullptr;
+		Viewer::Image* Loader		= nullptr;
+		int64 EstimatedBytes		= 0;
+	};
+}